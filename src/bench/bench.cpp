@@ -0,0 +1,30 @@
+#include "bench.hpp"
+
+#include <algorithm>
+
+namespace sofa_designer {
+namespace bench {
+
+std::vector<BenchCase> &registry()
+{
+    static std::vector<BenchCase> cases;
+    return cases;
+}
+
+void Bench::record(
+        const std::string &label,
+        std::size_t iters,
+        std::vector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    BenchResult r;
+    r.name = label.empty() ? name : name + "/" + label;
+    r.iters = iters;
+    r.ns_median = samples[samples.size() / 2] * 1e9;
+    r.ns_min = samples.front() * 1e9;
+    r.ns_max = samples.back() * 1e9;
+    res.push_back(r);
+}
+
+}; // namespace bench
+}; // namespace sofa_designer
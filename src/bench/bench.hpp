@@ -0,0 +1,121 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace sofa_designer {
+namespace bench {
+
+// Keeps the compiler from discarding a computed value
+template <typename T>
+inline void do_not_optimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct BenchResult {
+    std::string name;
+    std::size_t iters;
+    // nanoseconds per call of the measured body
+    double ns_median, ns_min, ns_max;
+};
+
+class Bench {
+    public:
+        Bench(const std::string &name, 
+                double min_time, 
+                std::size_t num_samples) :
+            name(name), min_time(min_time), num_samples(num_samples) {}
+
+        // Runs `body` repeatedly, first doubling the number of calls 
+        // until one sample takes min_time / num_samples seconds,
+        // then takes num_samples samples of that many calls.
+        // The body should only read its inputs so that every call 
+        // does the same amount of work.
+        template <typename F>
+        void run(F body);
+        // Same as run but labels the result as `name/label`,
+        // so that a case can measure several inputs
+        template <typename F>
+        void run(const std::string &label, F body);
+
+        const std::vector<BenchResult> &results() const { return res; }
+
+    private:
+        std::string name;
+        double min_time;
+        std::size_t num_samples;
+        std::vector<BenchResult> res;
+
+        template <typename F>
+        static double time_calls(F &body, std::size_t iters);
+        void record(const std::string &label, 
+                std::size_t iters, 
+                std::vector<double> samples);
+};
+
+typedef void (*BenchFunction)(Bench &);
+
+struct BenchCase {
+    std::string name;
+    BenchFunction fn;
+};
+
+std::vector<BenchCase> &registry();
+
+struct BenchRegistrar {
+    BenchRegistrar(const char *name, BenchFunction fn)
+    {
+        registry().push_back({name, fn});
+    }
+};
+
+template <typename F>
+double Bench::time_calls(F &body, std::size_t iters)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iters; i++)
+        body();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+template <typename F>
+void Bench::run(F body)
+{
+    run("", body);
+}
+
+template <typename F>
+void Bench::run(const std::string &label, F body)
+{
+    double sample_time = min_time / num_samples;
+    std::size_t iters = 1;
+    // warm up caches and calibrate
+    while (time_calls(body, iters) < sample_time)
+        iters *= 2;
+
+    std::vector<double> samples(num_samples);
+    for (auto &t : samples)
+        t = time_calls(body, iters) / iters;
+    record(label, iters, std::move(samples));
+}
+
+}; // namespace bench
+}; // namespace sofa_designer
+
+#define BENCH_CONCAT_IMPL(a, b) a##b
+#define BENCH_CONCAT(a, b) BENCH_CONCAT_IMPL(a, b)
+#define BENCH_CASE_IMPL(fn, name) \
+    static void fn(::sofa_designer::bench::Bench &); \
+    static ::sofa_designer::bench::BenchRegistrar \
+        BENCH_CONCAT(fn, _registrar)(name, fn); \
+    static void fn(::sofa_designer::bench::Bench &bench)
+// Defines a benchmark case with a `bench` object in scope
+#define BENCH_CASE(name) \
+    BENCH_CASE_IMPL(BENCH_CONCAT(bench_case_, __LINE__), name)
+
+#endif // BENCH_HPP
@@ -0,0 +1,69 @@
+#include "fixtures.hpp"
+
+#include <map>
+#include <memory>
+#include <tuple>
+
+#include <gmpxx.h>
+
+#include "search.hpp"
+
+namespace sofa_designer {
+namespace bench {
+
+std::vector<Coord> init_normals()
+{
+    return {
+        Coord(24_mpq/25_mpz, 7_mpq/25_mpz),
+        Coord(56_mpq/65_mpz, 33_mpq/65_mpz),
+        Coord(120_mpq/169_mpz, 119_mpq/169_mpz),
+        Coord(33_mpq/65_mpz, 56_mpq/65_mpz),
+        Coord(7_mpq/25_mpz, 24_mpq/25_mpz),
+    };
+}
+
+const std::vector<std::size_t> &sample_depths()
+{
+    static const std::vector<std::size_t> depths = {0, 10, 20, 40};
+    return depths;
+}
+
+const Sofa &sofa_at_depth(std::size_t depth)
+{
+    static std::map< std::size_t, std::unique_ptr<Sofa> > mem;
+    static std::unique_ptr<Sofa> deepest;
+    static std::size_t deepest_depth = 0;
+
+    if (mem.count(depth))
+        return *mem[depth];
+
+    if (!deepest) {
+        auto sofas = Sofa::a_priori_sofas(
+                init_normals(), kInitMuFixIdx, kInitNumSofas);
+        deepest.reset(sofas[0]);
+        for (std::size_t i = 1; i < sofas.size(); i++)
+            delete sofas[i];
+        deepest_depth = 0;
+    }
+    // restart from the root if asked for a shallower sofa
+    if (depth < deepest_depth) {
+        deepest.reset();
+        return sofa_at_depth(depth);
+    }
+
+    while (deepest_depth < depth) {
+        Sofa *s1, *s2;
+        std::tie(s1, s2) = search::branch(deepest.get(), kInitMuFixIdx);
+        if (s1->area() < s2->area())
+            std::swap(s1, s2);
+        delete s2;
+        deepest.reset(s1);
+        deepest_depth++;
+    }
+
+    mem[depth].reset(new Sofa(*deepest));
+    return *mem[depth];
+}
+
+}; // namespace bench
+}; // namespace sofa_designer
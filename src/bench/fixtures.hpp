@@ -0,0 +1,32 @@
+#ifndef FIXTURES_HPP
+#define FIXTURES_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "sofa.hpp"
+
+namespace sofa_designer {
+namespace bench {
+
+using sofa::Sofa;
+using geometry::Coord;
+
+// The 5-angle Pythagorean normals of init.sofa
+std::vector<Coord> init_normals();
+const std::size_t kInitMuFixIdx = 2;
+const std::size_t kInitNumSofas = 4;
+
+// Depths at which sofas are sampled by the benchmarks
+const std::vector<std::size_t> &sample_depths();
+
+// The sofa reached from the first initial sofa of init.sofa
+// after `depth` branchings, always descending into the child 
+// of larger area as the DFS of main would.
+// Results are cached and owned by the fixture.
+const Sofa &sofa_at_depth(std::size_t depth);
+
+}; // namespace bench
+}; // namespace sofa_designer
+
+#endif // FIXTURES_HPP
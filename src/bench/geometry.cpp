@@ -0,0 +1,39 @@
+#include "bench.hpp"
+
+#include <string>
+
+#include "fixtures.hpp"
+#include "line.hpp"
+
+namespace sofa_designer {
+namespace bench {
+
+using geometry::Line;
+
+// Lines are taken from sofas at different depths 
+// as the intercepts get longer denominators deeper in the search
+
+BENCH_CASE("Line::intersection") {
+    for (auto d : sample_depths()) {
+        Sofa s(sofa_at_depth(d));
+        Line l0 = s.ctx.line(s.ruu(0)), l1 = s.ctx.line(s.luu(3));
+        bench.run("depth " + std::to_string(d), [&]{
+                do_not_optimize(l0.intersection(l1));
+                });
+    }
+}
+
+BENCH_CASE("arrangement_general") {
+    for (auto d : sample_depths()) {
+        Sofa s(sofa_at_depth(d));
+        Line l0 = s.ctx.line(s.rud(0));
+        Line l1 = s.ctx.line(s.hu());
+        Line l2 = s.ctx.line(s.luu(4));
+        bench.run("depth " + std::to_string(d), [&]{
+                do_not_optimize(geometry::arrangement_general(l0, l1, l2));
+                });
+    }
+}
+
+}; // namespace bench
+}; // namespace sofa_designer
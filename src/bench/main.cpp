@@ -0,0 +1,48 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "bench.hpp"
+
+using namespace sofa_designer::bench;
+
+// Usage: ./bench [--min-time SECONDS] [--samples N] [FILTER...]
+// Runs every case whose name contains one of the FILTERs
+// (all cases if none is given) and prints ns per call
+int main(int argc, const char * argv[])
+{
+    double min_time = 0.5;
+    std::size_t num_samples = 5;
+    std::vector<std::string> filters;
+    for (int i = 1; i < argc; i++) {
+        if (!std::strcmp(argv[i], "--min-time") && i + 1 < argc)
+            min_time = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--samples") && i + 1 < argc)
+            num_samples = std::strtoul(argv[++i], nullptr, 10);
+        else
+            filters.push_back(argv[i]);
+    }
+    if (num_samples == 0)
+        num_samples = 1;
+
+    std::printf("%-48s %10s %14s %14s %14s\n", 
+            "benchmark", "iters", "median ns", "min ns", "max ns");
+    for (const auto &c : registry()) {
+        bool selected = filters.empty();
+        for (const auto &f : filters)
+            if (c.name.find(f) != std::string::npos)
+                selected = true;
+        if (!selected)
+            continue;
+
+        Bench bench(c.name, min_time, num_samples);
+        c.fn(bench);
+        for (const auto &r : bench.results())
+            std::printf("%-48s %10zu %14.1f %14.1f %14.1f\n", 
+                    r.name.c_str(), r.iters, 
+                    r.ns_median, r.ns_min, r.ns_max);
+        std::fflush(stdout);
+    }
+    return 0;
+}
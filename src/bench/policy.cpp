@@ -0,0 +1,39 @@
+#include "bench.hpp"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fixtures.hpp"
+#include "policy.hpp"
+
+namespace sofa_designer {
+namespace bench {
+
+using search::BranchingPolicy;
+
+// Cost of one decision of each policy, on a copy of the sofa 
+// without cached gains. The number of nodes each policy needs 
+// is compared by `exec --bench --policy P` on the scenarios.
+BENCH_CASE("BranchingPolicy::choose") {
+    std::vector< std::pair< std::string, std::shared_ptr<BranchingPolicy> > > 
+        policies = {
+            {"greedy", std::make_shared<search::GreedyPolicy>()},
+            {"maxmin", std::make_shared<search::MaxMinPolicy>()},
+            {"lookahead", std::make_shared<search::LookaheadPolicy>()},
+        };
+    for (const auto &p : policies) {
+        for (auto d : sample_depths()) {
+            const Sofa &s = sofa_at_depth(d);
+            bench.run(p.first + "/depth " + std::to_string(d), [&]{
+                    Sofa c(s);
+                    c.gains.assign(c.gains.size(), sofa::HalveGainCache());
+                    do_not_optimize(p.second->choose(c));
+                    });
+        }
+    }
+}
+
+}; // namespace bench
+}; // namespace sofa_designer
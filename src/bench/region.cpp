@@ -0,0 +1,52 @@
+#include "bench.hpp"
+
+#include <string>
+
+#include "fixtures.hpp"
+#include "region.hpp"
+
+namespace sofa_designer {
+namespace bench {
+
+typedef geometry::HalfPlaneRegion<sofa::SofaLineContext> HalfPlaneRegion;
+typedef geometry::UnionOfTwoHalfPlanesRegion<sofa::SofaLineContext> 
+    UnionOfTwoHalfPlanesRegion;
+
+// The regions are the ones that Sofa(const Sofa &, ...) clips with.
+// Arrangements are cached in the context after the first call,
+// so these time the clipping itself.
+
+BENCH_CASE("HalfPlaneRegion::intersection") {
+    for (auto d : sample_depths()) {
+        Sofa s(sofa_at_depth(d));
+        HalfPlaneRegion r(s.ctx, short(~s.rud(1)));
+        bench.run("depth " + std::to_string(d), [&]{
+                do_not_optimize(r.intersection(s.polygons));
+                });
+    }
+}
+
+BENCH_CASE("HalfPlaneRegion::intersection(out)") {
+    for (auto d : sample_depths()) {
+        Sofa s(sofa_at_depth(d));
+        HalfPlaneRegion r(s.ctx, short(~s.rud(1)));
+        geometry::Polygons out;
+        bench.run("depth " + std::to_string(d), [&]{
+                r.intersection(s.polygons, out);
+                do_not_optimize(out);
+                });
+    }
+}
+
+BENCH_CASE("UnionOfTwoHalfPlanesRegion::intersection") {
+    for (auto d : sample_depths()) {
+        Sofa s(sofa_at_depth(d));
+        UnionOfTwoHalfPlanesRegion r(s.ctx, s.ldd(1), s.rdu(1));
+        bench.run("depth " + std::to_string(d), [&]{
+                do_not_optimize(r.intersection(s.polygons));
+                });
+    }
+}
+
+}; // namespace bench
+}; // namespace sofa_designer
@@ -0,0 +1,68 @@
+#include "bench.hpp"
+
+#include <string>
+#include <tuple>
+
+#include "fixtures.hpp"
+#include "search.hpp"
+
+namespace sofa_designer {
+namespace bench {
+
+using sofa::HalveType;
+
+BENCH_CASE("Sofa::calc_area") {
+    for (auto d : sample_depths()) {
+        Sofa s(sofa_at_depth(d));
+        bench.run("depth " + std::to_string(d), [&]{
+                do_not_optimize(s.calc_area(s.polygons));
+                });
+    }
+}
+
+// Root construction from the box of a sofa, as done on restoring
+// a checkpoint or a spilled run
+BENCH_CASE("Sofa::from_record") {
+    for (auto d : sample_depths()) {
+        const Sofa &s = sofa_at_depth(d);
+        sofa::SofaRecord r = s.record();
+        bench.run("depth " + std::to_string(d), [&]{
+                Sofa *c = Sofa::from_record(init_normals(), s.mu_fix_idx, r);
+                delete c;
+                });
+    }
+}
+
+// All the candidates that branch() compares
+BENCH_CASE("Sofa::halve_gain") {
+    for (auto d : sample_depths()) {
+        Sofa s(sofa_at_depth(d));
+        bench.run("depth " + std::to_string(d), [&]{
+                for (std::size_t i = 0; i < s.n; i++)
+                    for (auto t : {sofa::kMuDown, sofa::kMuUp, 
+                            sofa::kNuDown, sofa::kNuUp}) {
+                        if (i == s.mu_fix_idx && Sofa::is_mu(t))
+                            continue;
+                        do_not_optimize(s.calc_halve_gain(i, t));
+                    }
+                });
+    }
+}
+
+// One full node of the search: a fresh copy of the sofa 
+// (so no arrangement is cached) is branched into two children
+BENCH_CASE("search::branch") {
+    for (auto d : sample_depths()) {
+        const Sofa &s = sofa_at_depth(d);
+        bench.run("depth " + std::to_string(d), [&]{
+                Sofa c(s);
+                Sofa *s1, *s2;
+                std::tie(s1, s2) = search::branch(&c, s.mu_fix_idx);
+                delete s1;
+                delete s2;
+                });
+    }
+}
+
+}; // namespace bench
+}; // namespace sofa_designer
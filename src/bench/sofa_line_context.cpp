@@ -0,0 +1,42 @@
+#include "bench.hpp"
+
+#include <string>
+#include <vector>
+
+#include "fixtures.hpp"
+#include "sofa_line_context.hpp"
+
+namespace sofa_designer {
+namespace bench {
+
+using sofa::BandPair;
+using sofa::SofaLineContext;
+
+BENCH_CASE("SofaLineContext construction") {
+    for (auto d : sample_depths()) {
+        const Sofa &s = sofa_at_depth(d);
+        std::vector<BandPair> bps = Sofa::make_band_pairs(
+                s.mu, s.nu, s.mu_range, s.nu_range, s.mu_fix_idx);
+        bench.run("depth " + std::to_string(d), [&]{
+                SofaLineContext ctx(bps);
+                do_not_optimize(ctx);
+                });
+    }
+}
+
+BENCH_CASE("SofaLineContext branching") {
+    for (auto d : sample_depths()) {
+        const Sofa &s = sofa_at_depth(d);
+        for (auto dir : {sofa::kDown, sofa::kUp}) {
+            std::string label = "depth " + std::to_string(d) + 
+                (dir == sofa::kDown ? " down" : " up");
+            bench.run(label, [&]{
+                    SofaLineContext ctx(s.ctx, 1, dir);
+                    do_not_optimize(ctx);
+                    });
+        }
+    }
+}
+
+}; // namespace bench
+}; // namespace sofa_designer
@@ -0,0 +1,75 @@
+#include "approx.hpp"
+
+namespace sofa_designer {
+namespace geometry {
+
+ApproxPolygon approx_clip(
+        const ApproxPolygon &poly,
+        const ApproxLine &line,
+        bool above)
+{
+    // Sutherland-Hodgman against a single half-plane
+    ApproxPolygon res;
+    if (poly.empty())
+        return res;
+    res.reserve(poly.size() + 2);
+
+    auto side = [&](const ApproxCoord &p) {
+        double v = p.y - (line.slope * p.x + line.intercept);
+        return above ? v : -v;
+    };
+
+    const ApproxCoord *a = &poly.back();
+    double fa = side(*a);
+    for (const ApproxCoord &b : poly) {
+        double fb = side(b);
+        if ((fa >= 0) != (fb >= 0)) {
+            double t = fa / (fa - fb);
+            res.push_back({a->x + (b.x - a->x) * t, a->y + (b.y - a->y) * t});
+        }
+        if (fb >= 0)
+            res.push_back(b);
+        a = &b;
+        fa = fb;
+    }
+    return res;
+}
+
+bool approx_misses(
+        const ApproxPolygons &polys,
+        const ApproxLine &line,
+        bool above,
+        double margin)
+{
+    for (const auto &poly : polys)
+        for (const ApproxCoord &p : poly) {
+            double v = p.y - (line.slope * p.x + line.intercept);
+            if ((above ? v : -v) >= -margin)
+                return false;
+        }
+    return true;
+}
+
+double approx_area(const ApproxPolygon &poly)
+{
+    if (poly.empty())
+        return 0;
+    double res = 0;
+    const ApproxCoord *c0 = &poly.back();
+    for (const ApproxCoord &c1 : poly) {
+        res += c0->x * c1.y - c0->y * c1.x;
+        c0 = &c1;
+    }
+    return res / 2;
+}
+
+double approx_area(const ApproxPolygons &polys)
+{
+    double res = 0;
+    for (const auto &p : polys)
+        res += approx_area(p);
+    return res;
+}
+
+}; // namespace geometry
+}; // namespace sofa_designer
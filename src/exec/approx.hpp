@@ -0,0 +1,54 @@
+#ifndef APPROX_HPP
+#define APPROX_HPP
+
+#include <vector>
+
+#include "line.hpp"
+
+namespace sofa_designer {
+namespace geometry {
+
+// Floating-point shadows of the exact geometry,
+// used where only an estimate is needed
+
+struct ApproxCoord {
+    double x, y;
+};
+
+typedef std::vector<ApproxCoord> ApproxPolygon;
+typedef std::vector<ApproxPolygon> ApproxPolygons;
+
+struct ApproxLine {
+    double slope, intercept;
+
+    ApproxLine(const Line &l) : 
+        slope(l.slope.get_d()), intercept(l.intercept.get_d()) {}
+};
+
+// Part of `poly` in the closed half-plane above `line` if `above`,
+// below otherwise. As in HalfPlaneRegion, a polygon cut into 
+// several pieces comes back as one polygon whose pieces are joined 
+// by zero-area slivers along the line, so its area is still right.
+ApproxPolygon approx_clip(
+        const ApproxPolygon &poly,
+        const ApproxLine &line,
+        bool above);
+
+// Whether every vertex of `polys` is off the closed half-plane 
+// above `line` if `above`, below it otherwise, by more than `margin`.
+// If the error of the vertices is below `margin`, 
+// the exact polygons have no area in common with the half-plane.
+bool approx_misses(
+        const ApproxPolygons &polys,
+        const ApproxLine &line,
+        bool above,
+        double margin);
+
+// Signed area, positive for counterclockwise polygons
+double approx_area(const ApproxPolygon &poly);
+double approx_area(const ApproxPolygons &polys);
+
+}; // namespace geometry
+}; // namespace sofa_designer
+
+#endif // APPROX_HPP
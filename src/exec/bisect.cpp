@@ -0,0 +1,124 @@
+#include "bisect.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <utility>
+
+namespace sofa_designer {
+namespace search {
+
+using sofa::Coord;
+using sofa::SofaRecord;
+
+BisectResult bisect_target(
+        std::vector<Sofa*> sofas,
+        const mpq_class &guess,
+        std::size_t mu_fix_idx,
+        const SearchConfig &config,
+        const BisectConfig &bisect,
+        std::ostream *out)
+{
+    typedef std::chrono::steady_clock Clock;
+    auto start_time = Clock::now();
+    assert(sofas.size());
+    const std::vector<Coord> normals = sofas[0]->mu;
+
+    BisectResult res;
+    std::vector<Sofa*> open = std::move(sofas);
+    std::vector<SofaRecord> closed;
+    mpq_class target = guess, step = bisect.step;
+    while (true) {
+        double left = bisect.time_budget - std::chrono::duration<double>(
+                Clock::now() - start_time).count();
+        if (left <= 0)
+            break;
+
+        // reopen the boxes that this target does not close
+        auto t0 = Clock::now();
+        BisectAttempt attempt;
+        attempt.target = target;
+        attempt.num_reopened = 0;
+        std::vector<SofaRecord> still_closed;
+        for (auto &r : closed) {
+            if (r.area < target) {
+                still_closed.push_back(std::move(r));
+            } else {
+                open.push_back(Sofa::from_record(normals, mu_fix_idx, r));
+                attempt.num_reopened++;
+            }
+        }
+        closed = std::move(still_closed);
+
+        // give up once the rest of the budget looks too short
+        SearchConfig c = config;
+        c.keep_closed = true;
+        c.time_limit = left;
+        c.abort_eta = left;
+        c.abort_after = std::min(config.abort_after, left / 10);
+        c.num_iter_per_batch = std::min(
+                config.num_iter_per_batch, bisect.max_iter_per_batch);
+        // the closed boxes count for the volume from which 
+        // run_search estimates the time left
+        SearchStats stats;
+        stats.root_closed_depths.resize(config.num_roots);
+        for (const auto &r : closed) {
+            auto &h = stats.root_closed_depths[r.root_idx];
+            if (h.size() <= r.depth)
+                h.resize(r.depth + 1);
+            h[r.depth]++;
+        }
+        open = run_search(std::move(open), target, mu_fix_idx, c, stats);
+        for (auto &r : stats.closed_sofas)
+            closed.push_back(std::move(r));
+        attempt.certified = open.empty() && !stats.spill_failed;
+        attempt.seconds = std::chrono::duration<double>(Clock::now() - t0).count();
+        attempt.num_iter = stats.num_iter;
+        res.attempts.push_back(attempt);
+        if (out) {
+            *out << "Target " << target << " (" << target.get_d() << "): " <<
+                (attempt.certified ? "certified" : "not certified") << 
+                " after " << attempt.num_iter << " iterations in " << 
+                attempt.seconds << " s, " << 
+                attempt.num_reopened << " sofas reopened" << std::endl;
+        }
+        // open sofas may be lost, so the boxes no longer cover 
+        // the parameter space
+        if (stats.spill_failed)
+            break;
+
+        if (attempt.certified) {
+            res.has_certified = true;
+            res.certified = target;
+            // a failure above is only a lack of time spent there
+            if (res.has_failed && res.certified <= res.failed)
+                res.has_failed = false;
+        } else {
+            res.has_failed = true;
+            res.failed = target;
+        }
+
+        // next target
+        if (res.has_certified && res.has_failed) {
+            if (res.certified - res.failed <= bisect.tolerance)
+                break;
+            target = (res.certified + res.failed) / 2;
+        } else if (res.has_certified) {
+            if (step < target)
+                target -= step;
+            else
+                target /= 2;
+            step *= 2;
+        } else {
+            target += step;
+            step *= 2;
+        }
+    }
+
+    for (Sofa *s : open)
+        delete s;
+    return res;
+}
+
+}; // namespace search
+}; // namespace sofa_designer
@@ -0,0 +1,83 @@
+#ifndef BISECT_HPP
+#define BISECT_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include <gmpxx.h>
+
+#include "search.hpp"
+#include "sofa.hpp"
+
+namespace sofa_designer {
+namespace search {
+
+struct BisectConfig {
+    // Seconds for all the searches together
+    double time_budget;
+    // Stop once the lowest certified target and 
+    // the highest failed one are this close
+    mpq_class tolerance;
+    // Until both a certified and a failed target are known,
+    // the target moves away from the last one by `step`, 
+    // doubled after every move
+    mpq_class step;
+    // Upper bound on SearchConfig::num_iter_per_batch, so that 
+    // a search that will not finish in time is given up soon
+    std::size_t max_iter_per_batch;
+
+    BisectConfig() :
+        time_budget(600),
+        tolerance(1, 1000),
+        step(1, 20),
+        max_iter_per_batch(1000)
+    {
+    }
+};
+
+struct BisectAttempt {
+    mpq_class target;
+    bool certified;
+    double seconds;
+    unsigned long long num_iter;
+    // closed sofas of earlier searches opened again for this target
+    std::size_t num_reopened;
+};
+
+struct BisectResult {
+    // lowest target certified
+    bool has_certified;
+    mpq_class certified;
+    // highest target below `certified` that was not certified in time
+    bool has_failed;
+    mpq_class failed;
+    std::vector<BisectAttempt> attempts;
+
+    BisectResult() : has_certified(false), has_failed(false) {}
+};
+
+// Looks for the lowest target that the search can certify 
+// within config.time_budget, starting from `guess`, 
+// by searching with one target after another.
+//
+// All searches share one cover of the parameter space by boxes:
+// the open sofas, and records of the closed ones with their areas.
+// A search for a target keeps every box with a smaller area closed
+// and only branches the others, so a failed search for a low target
+// leaves work for the next one, and a certified high target leaves
+// only the boxes above the next target to reopen.
+// Stops at the first search with SearchStats::spill_failed.
+// Takes ownership of `sofas`.
+BisectResult bisect_target(
+        std::vector<Sofa*> sofas,
+        const mpq_class &guess,
+        std::size_t mu_fix_idx,
+        const SearchConfig &config,
+        const BisectConfig &bisect,
+        std::ostream *out);
+
+}; // namespace search
+}; // namespace sofa_designer
+
+#endif // BISECT_HPP
@@ -0,0 +1,225 @@
+#include "frontier.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+
+namespace sofa_designer {
+namespace search {
+
+static bool larger_area(const Sofa *a, const Sofa *b)
+{
+    return b->area() < a->area();
+}
+
+// why a read or write of file failed. errno only tells when the stream
+// has its error flag set, as a short read at the end of file or 
+// a failed raw GMP call may leave it stale.
+static const char *io_cause(FILE *file)
+{
+    if (std::ferror(file) && errno)
+        return std::strerror(errno);
+    if (std::feof(file))
+        return "unexpected end of file";
+    return "I/O error";
+}
+
+Frontier::Frontier(
+        std::vector<Coord> normals,
+        std::size_t mu_fix_idx,
+        std::size_t max_in_memory,
+        std::string spill_dir) :
+    num_spilled(0),
+    num_restored(0),
+    failed(false),
+    normals(normals),
+    mu_fix_idx(mu_fix_idx),
+    max_in_memory(max_in_memory),
+    spill_dir(spill_dir),
+    hot_sorted(true),
+    num_in_runs(0)
+{
+}
+
+Frontier::~Frontier()
+{
+    for (Sofa *s : hot)
+        delete s;
+    for (auto &r : runs)
+        std::fclose(r.file);
+}
+
+bool Frontier::push(Sofa *s)
+{
+    hot.push_back(s);
+    hot_sorted = false;
+    // once a run failed, every sofa stays in memory
+    if (max_in_memory && hot.size() > max_in_memory && !failed)
+        spill();
+    return !failed;
+}
+
+bool Frontier::push(const std::vector<Sofa*> &sofas)
+{
+    for (Sofa *s : sofas)
+        push(s);
+    return !failed;
+}
+
+std::vector<Sofa*> Frontier::pop(std::size_t max_num)
+{
+    sort_hot();
+    std::vector<Sofa*> res;
+    std::size_t num_hot = 0;
+    while (res.size() < max_num) {
+        std::size_t i = best_run();
+        bool has_hot = (num_hot < hot.size());
+        if (i == runs.size() && !has_hot)
+            break;
+        if (i == runs.size() || 
+                (has_hot && !(hot[num_hot]->area() < runs[i].head.area))) {
+            res.push_back(hot[num_hot++]);
+        } else {
+            res.push_back(Sofa::from_record(normals, mu_fix_idx, take_head(i)));
+            num_restored++;
+        }
+    }
+    hot.erase(hot.begin(), hot.begin() + num_hot);
+    return res;
+}
+
+void Frontier::sort_hot()
+{
+    if (!hot_sorted)
+        std::stable_sort(hot.begin(), hot.end(), larger_area);
+    hot_sorted = true;
+}
+
+void Frontier::spill()
+{
+    // keep the larger half, which pop() hands out first
+    sort_hot();
+    std::size_t num_kept = max_in_memory / 2;
+    FILE *file = open_run();
+    if (!file)
+        return;
+    bool ok = true;
+    for (std::size_t i = num_kept; ok && i < hot.size(); i++)
+        ok = hot[i]->record().write(file);
+    if (!ok || std::fflush(file) != 0) {
+        // the sofas are still in memory
+        fail("write", io_cause(file));
+        std::fclose(file);
+        return;
+    }
+    for (std::size_t i = num_kept; i < hot.size(); i++)
+        delete hot[i];
+    std::size_t num = hot.size() - num_kept;
+    hot.resize(num_kept);
+    num_spilled += num;
+    add_run(file, num);
+    if (runs.size() > kMaxRuns)
+        merge_runs();
+}
+
+FILE *Frontier::open_run()
+{
+    FILE *file;
+    if (spill_dir.empty()) {
+        file = std::tmpfile();
+    } else {
+        std::string path = spill_dir + "/sofa-run-XXXXXX";
+        std::vector<char> buf(path.begin(), path.end());
+        buf.push_back('\0');
+        int fd = mkstemp(buf.data());
+        if (fd < 0) {
+            fail("create", std::strerror(errno));
+            return nullptr;
+        }
+        unlink(buf.data());
+        file = fdopen(fd, "w+b");
+        if (!file) {
+            fail("create", std::strerror(errno));
+            close(fd);
+            return nullptr;
+        }
+    }
+    if (!file)
+        fail("create", std::strerror(errno));
+    return file;
+}
+
+void Frontier::fail(const char *what, const char *cause)
+{
+    std::cerr << "Could not " << what << " a run of open sofas";
+    if (!spill_dir.empty())
+        std::cerr << " in " << spill_dir;
+    std::cerr << ": " << cause << std::endl;
+    failed = true;
+}
+
+std::size_t Frontier::best_run() const
+{
+    std::size_t res = runs.size();
+    for (std::size_t i = 0; i < runs.size(); i++)
+        if (res == runs.size() || runs[res].head.area < runs[i].head.area)
+            res = i;
+    return res;
+}
+
+SofaRecord Frontier::take_head(std::size_t i)
+{
+    Run &r = runs[i];
+    SofaRecord res = std::move(r.head);
+    r.num_left--;
+    num_in_runs--;
+    if (!r.num_left || !SofaRecord::read(r.file, r.head)) {
+        if (r.num_left)
+            fail("read", io_cause(r.file));
+        num_in_runs -= r.num_left;
+        std::fclose(r.file);
+        runs.erase(runs.begin() + i);
+    }
+    return res;
+}
+
+void Frontier::add_run(FILE *file, std::size_t num)
+{
+    if (!num) {
+        std::fclose(file);
+        return;
+    }
+    std::rewind(file);
+    Run r = {file, num, SofaRecord()};
+    if (!SofaRecord::read(file, r.head)) {
+        fail("read", io_cause(file));
+        std::fclose(file);
+        return;
+    }
+    runs.push_back(std::move(r));
+    num_in_runs += num;
+}
+
+void Frontier::merge_runs()
+{
+    FILE *file = open_run();
+    if (!file)
+        return;
+    std::size_t num = 0;
+    bool ok = true;
+    for (std::size_t i; ok && (i = best_run()) != runs.size(); num++)
+        ok = take_head(i).write(file);
+    if (!ok || std::fflush(file) != 0) {
+        // the records taken from the runs are lost
+        fail("write", io_cause(file));
+        std::fclose(file);
+        return;
+    }
+    add_run(file, num);
+}
+
+}; // namespace search
+}; // namespace sofa_designer
@@ -0,0 +1,104 @@
+#ifndef FRONTIER_HPP
+#define FRONTIER_HPP
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <gmpxx.h>
+
+#include "sofa.hpp"
+
+namespace sofa_designer {
+namespace search {
+
+using sofa::Coord;
+using sofa::Sofa;
+using sofa::SofaRecord;
+
+// Open sofas, handed out in decreasing order of area.
+//
+// At most max_in_memory of them are kept as Sofa objects. Beyond that, 
+// the smaller half is written as SofaRecords to a run file sorted 
+// by area, and deleted. pop() merges the sofas in memory with the heads 
+// of the runs, reading each run one record at a time, and rebuilds 
+// the records it takes with Sofa::from_record.
+// Run files are unlinked as soon as they are created, so that 
+// they are gone with the process.
+// A run that cannot be created, written or read is reported on stderr 
+// and sets `failed`. The sofas it was to hold stay in memory, but 
+// the records left in a run that cannot be read back are lost.
+class Frontier {
+    public:
+        // Runs are created in spill_dir, or by std::tmpfile if it is empty.
+        // max_in_memory == 0 keeps every sofa in memory.
+        Frontier(
+                std::vector<Coord> normals,
+                std::size_t mu_fix_idx,
+                std::size_t max_in_memory,
+                std::string spill_dir = "");
+        ~Frontier();
+        Frontier(const Frontier &other) = delete;
+        Frontier &operator=(const Frontier &other) = delete;
+
+        // Takes ownership of the sofas.
+        // False once a run has failed.
+        bool push(Sofa *s);
+        bool push(const std::vector<Sofa*> &sofas);
+        // Up to `max_num` sofas of largest area, largest first.
+        // The caller owns them.
+        std::vector<Sofa*> pop(std::size_t max_num);
+
+        // Number of sofas in memory and in runs
+        std::size_t size() const {return hot.size() + num_in_runs;}
+        bool empty() const {return !size();}
+
+        std::size_t num_runs() const {return runs.size();}
+        // Records written to and read back from runs so far
+        unsigned long long num_spilled, num_restored;
+        // Whether a run has failed; no more runs are written then
+        bool failed;
+
+    private:
+        // A run file read from the front, with its next record
+        struct Run {
+            FILE *file;
+            std::size_t num_left;
+            SofaRecord head;
+        };
+
+        std::vector<Coord> normals;
+        std::size_t mu_fix_idx;
+        std::size_t max_in_memory;
+        std::string spill_dir;
+        // sorted by decreasing area if hot_sorted
+        std::vector<Sofa*> hot;
+        bool hot_sorted;
+        std::vector<Run> runs;
+        std::size_t num_in_runs;
+
+        // no more runs than this are read at the same time
+        static const std::size_t kMaxRuns = 16;
+
+        void sort_hot();
+        void spill();
+        // nullptr on failure
+        FILE *open_run();
+        // reports the failure to `what` a run because of `cause`
+        // and sets `failed`
+        void fail(const char *what, const char *cause);
+        // the run with the largest head, or runs.size() if none
+        std::size_t best_run() const;
+        // moves the head of runs[i] out and reads the next one,
+        // dropping the run if that fails
+        SofaRecord take_head(std::size_t i);
+        // starts reading `file` holding `num` records from the front
+        void add_run(FILE *file, std::size_t num);
+        void merge_runs();
+};
+
+}; // namespace search
+}; // namespace sofa_designer
+
+#endif // FRONTIER_HPP
@@ -0,0 +1,75 @@
+#include "intersection_store.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+#include "profile.hpp"
+
+namespace sofa_designer {
+namespace sofa {
+
+IntersectionStore &IntersectionStore::get()
+{
+    static IntersectionStore store;
+    return store;
+}
+
+static std::size_t mix(std::size_t h, std::size_t v)
+{
+    return (h ^ v) * std::size_t(0x100000001b3ull) + (h >> 29);
+}
+
+static std::size_t hash_mpz(std::size_t h, mpz_srcptr z)
+{
+    h = mix(h, std::size_t(mpz_sgn(z)) + 2);
+    for (std::size_t i = 0; i < mpz_size(z); i++)
+        h = mix(h, mpz_getlimbn(z, i));
+    return h;
+}
+
+static std::size_t hash_mpq(std::size_t h, const mpq_class &q)
+{
+    return hash_mpz(hash_mpz(h, q.get_num_mpz_t()), q.get_den_mpz_t());
+}
+
+std::size_t IntersectionStore::LineHash::operator()(const Line &l) const
+{
+    std::size_t h = 0xcbf29ce484222325ull;
+    h = hash_mpq(h, l.slope);
+    h = hash_mpq(h, l.intercept);
+    return h;
+}
+
+std::size_t IntersectionStore::LinePairHash::operator()(const LinePair &p) const
+{
+    std::size_t h = 0xcbf29ce484222325ull;
+    h = mix(h, std::uintptr_t(p.first.get()));
+    h = mix(h, std::uintptr_t(p.second.get()));
+    return h;
+}
+
+SharedLine IntersectionStore::line(const Line &l)
+{
+    return lines.intern(l);
+}
+
+SharedCoord IntersectionStore::intersection(SharedLine l0, SharedLine l1)
+{
+    assert(l0->slope != l1->slope);
+    // the same pair in either order is the same entry
+    if (l1.get() < l0.get())
+        std::swap(l0, l1);
+    bool hit;
+    SharedCoord c = intersections.get(
+            LinePair(l0, l1),
+            [&]{return l0->intersection(*l1);},
+            &hit);
+    if (hit)
+        SOFA_PROFILE_COUNT(kIntersectionShared);
+    else
+        SOFA_PROFILE_COUNT(kIntersectionComputed);
+    return c;
+}
+
+}; // namespace sofa
+}; // namespace sofa_designer
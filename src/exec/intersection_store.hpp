@@ -0,0 +1,68 @@
+#ifndef INTERSECTION_STORE_HPP
+#define INTERSECTION_STORE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+#include "coord.hpp"
+#include "line.hpp"
+#include "shared_table.hpp"
+
+namespace sofa_designer {
+namespace sofa {
+
+using geometry::Coord;
+using geometry::Line;
+
+typedef std::shared_ptr<const Line> SharedLine;
+typedef std::shared_ptr<const Coord> SharedCoord;
+
+// Lines and exact intersections of pairs of lines, shared by all 
+// contexts of all threads. Sibling and cousin sofas share most of 
+// their lines, and their intercepts are refined from the same 
+// dyadic grid, so the same lines and intersections come up again 
+// and again. Each is made once for all contexts holding it, 
+// and a context copies pointers instead of rationals.
+//
+// Lines are interned, so that equal lines are the same pointer,
+// and intersections are looked up by the pair of pointers.
+class IntersectionStore {
+    public:
+        // The store of the process
+        static IntersectionStore &get();
+
+        IntersectionStore() {}
+        IntersectionStore(const IntersectionStore &other) = delete;
+        IntersectionStore &operator=(const IntersectionStore &other) = delete;
+
+        // The canonical copy of l
+        SharedLine line(const Line &l);
+        // The intersection of two lines of distinct slopes 
+        // given by line()
+        SharedCoord intersection(SharedLine l0, SharedLine l1);
+
+        SharedTableStats line_stats() const {return lines.stats();}
+        SharedTableStats intersection_stats() const 
+        {
+            return intersections.stats();
+        }
+
+    private:
+        typedef std::pair<SharedLine, SharedLine> LinePair;
+
+        struct LineHash {
+            std::size_t operator()(const Line &l) const;
+        };
+        struct LinePairHash {
+            std::size_t operator()(const LinePair &p) const;
+        };
+
+        SharedTable<Line, NoValue, LineHash> lines;
+        SharedTable<LinePair, Coord, LinePairHash> intersections;
+};
+
+}; // namespace sofa
+}; // namespace sofa_designer
+
+#endif // INTERSECTION_STORE_HPP
@@ -64,7 +64,7 @@ SlopeId VanillaLineContext::slope_id(LineId id) const
 }
 
 LineArrangement VanillaLineContext::arrangement(
-        LineId id0, LineId id1, LineId id2)
+        LineId id0, LineId id1, LineId id2) const
 {
     return sofa_designer::geometry::arrangement(
             lines[id0], lines[id1], lines[id2]);
@@ -25,15 +25,17 @@ class LineContext {
         virtual Coord intersection(
                 LineId id0, LineId id1) const = 0;
         virtual SlopeId slope_id(LineId id) const = 0;
+        // May fill a cache of the context, so a context should not
+        // be queried from several threads at once
         virtual LineArrangement arrangement(
                 LineId id0, 
                 LineId id1, 
-                LineId id2) = 0;
+                LineId id2) const = 0;
 
         virtual ~LineContext() = default; 
 };
 
-class VanillaLineContext : public LineContext {
+class VanillaLineContext final : public LineContext {
     public:
         VanillaLineContext();
         VanillaLineContext(const std::vector<Line> &lines);
@@ -48,7 +50,7 @@ class VanillaLineContext : public LineContext {
         LineArrangement arrangement(
                 LineId id0, 
                 LineId id1, 
-                LineId id2);
+                LineId id2) const;
 
     private:
         std::vector<Line> lines;
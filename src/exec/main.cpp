@@ -1,27 +1,171 @@
 #include <iostream>
 #include <algorithm>
 #include <vector>
-#include <queue>
 #include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
 #include <tuple>
 #include <gmp.h>
 #include <gmpxx.h>
-#include <thread>
-#include <future>
-#include <mutex>
 #include <utility>
 
+#include <sys/resource.h>
+
+#include "bisect.hpp"
+#include "intersection_store.hpp"
+#include "profile.hpp"
 #include "sofa.hpp"
+#include "sofa_tables.hpp"
+#include "search.hpp"
 
-// Program initialization constants
+using namespace sofa_designer::sofa;
+using sofa_designer::search::SearchConfig;
+using sofa_designer::search::SearchStats;
+using sofa_designer::search::run_search;
+using sofa_designer::search::BranchingPolicy;
+using sofa_designer::search::GreedyPolicy;
+using sofa_designer::search::MaxMinPolicy;
+using sofa_designer::search::LookaheadPolicy;
+using sofa_designer::search::RecordedPolicy;
+using sofa_designer::search::BisectConfig;
+using sofa_designer::search::BisectResult;
+using sofa_designer::search::bisect_target;
 
-// Number of workers
-const std::size_t num_threads = 30;
-// Each worker does iteration up to this number 
-// then redistributes all sofas to workers
-const std::size_t num_iter_per_batch = 10000;
+// Program options, given as command line arguments
+//
+// --threads N         number of workers
+// --iter-per-batch N  iterations of each worker between redistributions
+// --budget N          stop after N iterations in total
+// --target Q          override the target of the input
+// --report-interval S seconds between progress lines (default 10, 0 for none)
+// --abort-eta S       stop when the estimated time left exceeds S seconds,
+//                     checked from --abort-after seconds on (default 60)
+// --exact-gains       compute the gain of every branching candidate exactly
+//                     instead of screening them by floating-point estimates
+// --policy P          branching policy: greedy (default), maxmin, 
+//                     lookahead or recorded
+// --learn-budget N    iterations of the greedy search the recorded policy
+//                     learns its choices from (default 1000)
+// --split-levels K    halve each sofa K times in one iteration, asking the
+//                     policy at each level on the largest piece (default 1),
+//                     from depth --split-min-depth D on (default 0)
+// --bisect S          look for the lowest target certified within S seconds,
+//                     starting from the target of the input
+// --bisect-tol Q      stop when certified and failed targets are Q apart
+// --bisect-step Q     first step of the target before a bracket is found
+// --max-in-memory N   keep at most N open sofas in memory between batches,
+//                     spilling the others to disk (default 0, no limit)
+// --spill-dir DIR     directory of the spilled sofas (default: tmpfile)
+// --tables FILE       map the index tables shared by all processes from FILE,
+//                     writing them there first if missing
+// --bench             benchmark mode: no progress output, 
+//                     print a report of the run at the end
+// --profile-interval S seconds between JSON lines of profile counters
+//                     on stderr, when built with `make PROFILE=1`
+struct Options {
+    SearchConfig config;
+    bool bench;
+    std::string policy;
+    unsigned long long learn_budget;
+    bool override_target;
+    mpq_class target;
+    double bisect_time;
+    BisectConfig bisect;
+    std::string tables;
+};
 
-using namespace sofa_designer::sofa;
+void usage_exit(const char *prog)
+{
+    std::cerr << "Usage: " << prog << 
+        " [--threads N] [--iter-per-batch N] [--budget N]"
+        " [--target Q] [--report-interval S]"
+        " [--abort-eta S] [--abort-after S] [--exact-gains]"
+        " [--policy greedy|maxmin|lookahead|recorded] [--learn-budget N]"
+        " [--split-levels K] [--split-min-depth D]"
+        " [--bisect S] [--bisect-tol Q] [--bisect-step Q]"
+        " [--max-in-memory N] [--spill-dir DIR] [--tables FILE]"
+        " [--bench] [--profile-interval S]"
+        " < input.sofa" << std::endl;
+    std::exit(1);
+}
+
+Options parse_options(int argc, const char * argv[])
+{
+    Options opt;
+    opt.bench = false;
+    opt.policy = "greedy";
+    opt.learn_budget = 1000;
+    opt.override_target = false;
+    opt.bisect_time = 0;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        bool has_value = (i + 1 < argc);
+        if (!std::strcmp(arg, "--bench")) {
+            opt.bench = true;
+        } else if (!std::strcmp(arg, "--exact-gains")) {
+            opt.config.branch.num_exact = 0;
+        } else if (!std::strcmp(arg, "--policy") && has_value) {
+            opt.policy = argv[++i];
+        } else if (!std::strcmp(arg, "--learn-budget") && has_value) {
+            opt.learn_budget = std::strtoull(argv[++i], nullptr, 10);
+        } else if (!std::strcmp(arg, "--split-levels") && has_value) {
+            opt.config.split_levels = std::strtoul(argv[++i], nullptr, 10);
+        } else if (!std::strcmp(arg, "--split-min-depth") && has_value) {
+            opt.config.split_min_depth = std::strtoul(argv[++i], nullptr, 10);
+        } else if (!std::strcmp(arg, "--threads") && has_value) {
+            opt.config.num_threads = std::strtoul(argv[++i], nullptr, 10);
+        } else if (!std::strcmp(arg, "--iter-per-batch") && has_value) {
+            opt.config.num_iter_per_batch = std::strtoul(argv[++i], nullptr, 10);
+        } else if (!std::strcmp(arg, "--budget") && has_value) {
+            opt.config.node_budget = std::strtoull(argv[++i], nullptr, 10);
+        } else if (!std::strcmp(arg, "--report-interval") && has_value) {
+            opt.config.report_interval = std::atof(argv[++i]);
+        } else if (!std::strcmp(arg, "--abort-eta") && has_value) {
+            opt.config.abort_eta = std::atof(argv[++i]);
+        } else if (!std::strcmp(arg, "--abort-after") && has_value) {
+            opt.config.abort_after = std::atof(argv[++i]);
+        } else if (!std::strcmp(arg, "--profile-interval") && has_value) {
+            opt.config.profile_interval = std::atof(argv[++i]);
+        } else if (!std::strcmp(arg, "--max-in-memory") && has_value) {
+            opt.config.max_in_memory = std::strtoul(argv[++i], nullptr, 10);
+        } else if (!std::strcmp(arg, "--spill-dir") && has_value) {
+            opt.config.spill_dir = argv[++i];
+        } else if (!std::strcmp(arg, "--tables") && has_value) {
+            opt.tables = argv[++i];
+        } else if (!std::strcmp(arg, "--bisect") && has_value) {
+            opt.bisect_time = std::atof(argv[++i]);
+        } else if ((!std::strcmp(arg, "--bisect-tol") || 
+                    !std::strcmp(arg, "--bisect-step")) && has_value) {
+            mpq_class &q = (!std::strcmp(arg, "--bisect-tol") ? 
+                    opt.bisect.tolerance : opt.bisect.step);
+            if (q.set_str(argv[++i], 10))
+                usage_exit(argv[0]);
+            q.canonicalize();
+            if (q <= 0)
+                usage_exit(argv[0]);
+        } else if (!std::strcmp(arg, "--target") && has_value) {
+            opt.override_target = true;
+            if (opt.target.set_str(argv[++i], 10))
+                usage_exit(argv[0]);
+            opt.target.canonicalize();
+        } else {
+            usage_exit(argv[0]);
+        }
+    }
+    if (!opt.config.num_threads || !opt.config.num_iter_per_batch ||
+            !opt.config.split_levels)
+        usage_exit(argv[0]);
+    if (opt.policy != "greedy" && opt.policy != "maxmin" &&
+            opt.policy != "lookahead" && opt.policy != "recorded")
+        usage_exit(argv[0]);
+    if (opt.bench)
+        opt.config.print_progress = false;
+    return opt;
+}
 
 std::vector<Coord> init_normals()
 {
@@ -40,94 +184,109 @@ std::vector<Coord> init_normals()
     return normals;
 }
 
-std::tuple<Sofa*, Sofa*> branch(Sofa *s, std::size_t mu_fix_idx)
+// in MiB
+double peak_rss()
 {
-    bool is_mu = false;
-    std::size_t max_idx = 0;
-    mpq_class gain = s->halve_gain(max_idx, kNuDown);
-    for (std::size_t i = 0; i < s->n; i++) {
-        for (auto t : {kMuDown, kMuUp, kNuDown, kNuUp}) {
-            if (i == mu_fix_idx && Sofa::is_mu(t))
-                continue;
-            if (gain < s->halve_gain(i, t)) {
-                is_mu = Sofa::is_mu(t);
-                gain = s->halve_gain(i, t);
-                max_idx = i;
-            }
-        }
-    }
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    // bytes on Mac OS X
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    // kilobytes on linux
+    return usage.ru_maxrss / 1024.0;
+#endif
+}
 
-    assert(gain > 0);
+// Runs a greedy search from fresh initial sofas for opt.learn_budget 
+// iterations and returns the policy replaying its choices
+std::shared_ptr<const BranchingPolicy> learn_policy(
+        const Options &opt,
+        const std::vector<Coord> &normals,
+        std::size_t mu_fix_idx,
+        std::size_t num_sofas,
+        const mpq_class &target)
+{
+    SearchConfig config = opt.config;
+    config.node_budget = opt.learn_budget;
+    config.print_progress = false;
+    config.policy = nullptr;
+    SearchStats stats;
+    std::vector<Sofa*> sofas = run_search(
+            Sofa::a_priori_sofas(normals, mu_fix_idx, num_sofas), 
+            target, mu_fix_idx, config, stats);
+    for (Sofa *s : sofas)
+        delete s;
+    std::shared_ptr<RecordedPolicy> policy = std::make_shared<RecordedPolicy>(
+            stats.choice_depths, std::make_shared<GreedyPolicy>(opt.config.branch));
+    gmp_printf("Learned choices at %lu depths from %llu iterations\n", 
+            policy->num_recorded(), stats.num_iter);
+    return policy;
+}
 
-    if (is_mu)
-    {
-        Sofa *sd = new Sofa(*s, max_idx, kMuDown);
-        Sofa *su = new Sofa(*s, max_idx, kMuUp);
-        assert(sd->area + s->halve_gain(max_idx, kMuDown) == s->area);
-        assert(su->area + s->halve_gain(max_idx, kMuUp) == s->area);
-        return std::make_tuple(sd, su);
-    }
-    else
-    {
-        Sofa *sd = new Sofa(*s, max_idx, kNuDown);
-        Sofa *su = new Sofa(*s, max_idx, kNuUp);
-        assert(sd->area + s->halve_gain(max_idx, kNuDown) == s->area);
-        assert(su->area + s->halve_gain(max_idx, kNuUp) == s->area);
-        return std::make_tuple(sd, su);
-    }
+void print_closed_volume(const SearchStats &stats, std::size_t num_roots)
+{
+    std::printf("Closed volume: %.9f\n", 
+            stats.closed_volume(num_roots).get_d());
+    for (std::size_t r = 0; r < num_roots; r++)
+        std::printf("  initial sofa %zu: %.9f\n", 
+                r, stats.root_closed_volume(r).get_d());
 }
 
-// loop for sofa thread
-// gets the list of pointers to sofas to divide
-// returns the sofas undone and number of iterations
-std::tuple< std::vector<Sofa*>, std::size_t > sofa_thread(
-        std::vector<Sofa*> sofas, 
-        mpq_class target, 
-        std::size_t mu_fix_idx, 
-        std::size_t thread_idx)
+void print_bench_report(
+        const Options &opt,
+        const SearchStats &stats,
+        std::size_t num_open,
+        double init_time,
+        double total_time)
 {
-    static std::mutex mtx;
-    unsigned long long iter_cnt = 0;
-    while (sofas.size() && iter_cnt < num_iter_per_batch) {
-        Sofa *s = *sofas.rbegin();
-        sofas.pop_back();
-        if (s->area < target)
-            delete s;
-        else {
-            Sofa *s1, *s2;
-            std::tie(s1, s2) = branch(s, mu_fix_idx);
-            delete s;
-            for (Sofa *cs : {s1, s2}) {
-                if (cs->area < target) {
-                    delete cs;
-                } else {
-                    sofas.push_back(cs);
-                }
-            }
-        }
-        iter_cnt++;
-        if (iter_cnt % 1000U == 0) {
-            mtx.lock();
-            std::cout << "thread " << thread_idx << std::endl;
-            std::cout << "iter_cnt: " << iter_cnt;
-            std::cout << " depth: " << sofas.size() << std::endl;
-            std::cout << (*sofas.rbegin())->area.get_d() << std::endl;
-            Sofa &s = **sofas.rbegin();
-            for (Interval i : s.mu_range)
-                std::cout << "[" << i.max << ", " <<  i.min << "]" << ", ";
-            std::cout << "\n";
-            for (Interval i : s.nu_range)
-                std::cout << "[" << i.max << ", " <<  i.min << "]" << ", ";
-            std::cout << "\n";
-            std::cout << "\n";
-            mtx.unlock();
-        }
+    std::printf("\nBenchmark report\n");
+    std::printf("threads:            %zu\n", opt.config.num_threads);
+    std::printf("policy:             %s\n", opt.policy.c_str());
+    std::printf("iterations:         %llu\n", stats.num_iter);
+    unsigned long long num_branched = 0;
+    for (auto c : stats.branched_depths)
+        num_branched += c;
+    std::printf("halvings:           %llu\n", num_branched);
+    std::printf("batches:            %llu\n", stats.num_batches);
+    std::printf("open sofas left:    %zu\n", num_open);
+    if (opt.config.max_in_memory)
+        std::printf("spilled/restored:   %llu/%llu\n", 
+                stats.num_spilled, stats.num_restored);
+    const auto &store = sofa_designer::sofa::IntersectionStore::get();
+    sofa_designer::SharedTableStats ls = store.line_stats();
+    sofa_designer::SharedTableStats is = store.intersection_stats();
+    std::printf("lines:              %llu shared, %llu made, %zu kept\n",
+            ls.num_hits, ls.num_misses, ls.num_entries);
+    std::printf("intersections:      %llu shared, %llu computed, %zu kept\n",
+            is.num_hits, is.num_misses, is.num_entries);
+    std::printf("nodes/second:       %.1f\n", 
+            stats.search_time > 0 ? stats.num_iter / stats.search_time : 0.0);
+    std::printf("peak RSS (MiB):     %.1f\n", peak_rss());
+    std::printf("time init (s):      %.3f\n", init_time);
+    std::printf("time search (s):    %.3f\n", stats.search_time);
+    std::printf("time redistrib (s): %.3f\n", stats.redistribute_time);
+    std::printf("time total (s):     %.3f\n", total_time);
+    std::printf("\n%6s %12s %12s\n", "depth", "branched", "closed");
+    std::size_t max_depth = std::max(
+            stats.branched_depths.size(), stats.closed_depths.size());
+    for (std::size_t d = 0; d < max_depth; d++) {
+        unsigned long long b = 
+            d < stats.branched_depths.size() ? stats.branched_depths[d] : 0;
+        unsigned long long c = 
+            d < stats.closed_depths.size() ? stats.closed_depths[d] : 0;
+        if (b || c)
+            std::printf("%6zu %12llu %12llu\n", d, b, c);
     }
-    return std::make_pair(std::move(sofas), iter_cnt);
 }
 
 int main(int argc, const char * argv[])
 {
+    typedef std::chrono::steady_clock Clock;
+    auto start_time = Clock::now();
+
+    Options opt = parse_options(argc, argv);
+
     // Get input
 
     std::vector<Coord> normals = init_normals();
@@ -141,6 +300,8 @@ int main(int argc, const char * argv[])
     gmp_scanf(" Target: %Qd", target_t);
     mpq_class target(target_t);
     mpq_clear(target_t);
+    if (opt.override_target)
+        target = opt.target;
 
     gmp_printf("Using the following normal vectors:\n\n");
     for (const Coord &c : normals)
@@ -151,44 +312,67 @@ int main(int argc, const char * argv[])
 
     // Initial sofas
     gmp_printf("\nInitializing...\n\n");
+    auto init_start = Clock::now();
+    if (!opt.tables.empty() && !SofaTables::load(
+                opt.tables, Sofa::num_band_pairs(normals.size())))
+        std::cerr << "Could not map " << opt.tables << 
+            ", building the tables in memory" << std::endl;
     std::vector<Sofa*> sofas = Sofa::a_priori_sofas(normals, mu_fix_idx, num_sofas);
+    double init_time = 
+        std::chrono::duration<double>(Clock::now() - init_start).count();
 
-    // Run each batch through threads
-    std::size_t batch_num = 1;
-    std::size_t total_iter_cnt = 0;
-    while (sofas.size()) {
-        std::cout << "Batch #" << batch_num;
-        std::cout << " Total iteration: " << total_iter_cnt << std::endl;
-
-        // distribute the sofas to task_sofas
-        std::vector<Sofa*> task_sofas[num_threads];
-        for (std::size_t i = 0; i < sofas.size(); i++)
-            task_sofas[i % num_threads].push_back(sofas[i]);
-        sofas.clear();
-
-        // send divided task_sofas to workers
-        std::future< std::tuple< std::vector<Sofa*>, std::size_t > > 
-            done_sofas[num_threads];
-        for (std::size_t i = 0; i < num_threads; i++)
-            done_sofas[i] = std::async(sofa_thread, 
-                    task_sofas[i], 
-                    target, 
-                    mu_fix_idx, 
-                    i);
-
-        // gather sofas back to list
-        sofas.clear();
-        for (std::size_t i = 0; i < num_threads; i++) {
-            std::vector<Sofa*> done_sofa;
-            std::size_t iter_cnt;
-            std::tie(done_sofa, iter_cnt) = done_sofas[i].get();
-            sofas.insert(sofas.end(), done_sofa.begin(), done_sofa.end());
-            total_iter_cnt += iter_cnt;
-        }
-        
-        batch_num++;
+    opt.config.num_roots = num_sofas;
+    if (opt.policy == "maxmin")
+        opt.config.policy = std::make_shared<MaxMinPolicy>(opt.config.branch);
+    else if (opt.policy == "lookahead")
+        opt.config.policy = std::make_shared<LookaheadPolicy>(opt.config.branch);
+    else if (opt.policy == "recorded")
+        opt.config.policy = learn_policy(
+                opt, normals, mu_fix_idx, num_sofas, target);
+
+    if (opt.bisect_time > 0) {
+        opt.bisect.time_budget = opt.bisect_time;
+        opt.config.print_progress = false;
+        BisectResult res = bisect_target(std::move(sofas), target, 
+                mu_fix_idx, opt.config, opt.bisect, &std::cout);
+        if (res.has_certified)
+            gmp_printf("Lowest certified target: %Qd\n", res.certified.get_mpq_t());
+        else
+            gmp_printf("No target certified.\n");
+        if (res.has_failed)
+            gmp_printf("Highest target not certified: %Qd\n", res.failed.get_mpq_t());
+        return 0;
     }
-    gmp_printf("Done.\n");
-    std::cout << "Total iteration: " << total_iter_cnt << std::endl;
+
+    SearchStats stats;
+    sofas = run_search(std::move(sofas), target, mu_fix_idx, opt.config, stats);
+
+    if (stats.spill_failed)
+        gmp_printf("Stopped with %lu open sofas after a run file failed: "
+                "the target is not certified.\n", sofas.size());
+    else if (stats.aborted)
+        gmp_printf("Aborted with %lu open sofas: the target looks infeasible.\n", 
+                sofas.size());
+    else if (sofas.size())
+        gmp_printf("Stopped with %lu open sofas.\n", sofas.size());
+    else
+        gmp_printf("Done.\n");
+    std::cout << "Total iteration: " << stats.num_iter << std::endl;
+    print_closed_volume(stats, num_sofas);
+
+    if (opt.bench) {
+        double total_time = 
+            std::chrono::duration<double>(Clock::now() - start_time).count();
+        print_bench_report(opt, stats, sofas.size(), init_time, total_time);
+    }
+
+    if (sofa_designer::profile::kEnabled) {
+        std::cout << "\nProfile\n";
+        sofa_designer::profile::print_table(std::cout, stats.profile, 
+                stats.search_time * opt.config.num_threads);
+    }
+
+    for (Sofa *s : sofas)
+        delete s;
     return 0;
 }
@@ -0,0 +1,232 @@
+#include "policy.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <functional>
+
+namespace sofa_designer {
+namespace search {
+
+using namespace sofa_designer::sofa;
+
+// Index of the candidate with the largest exact score,
+// screened by the estimates as described in BranchConfig.
+// Ties go to the earliest candidate.
+static std::size_t best_candidate(
+        std::size_t num_candidates,
+        const std::function<double(std::size_t)> &approx_score,
+        const std::function<mpq_class(std::size_t)> &exact_score,
+        const BranchConfig &config,
+        mpq_class &best)
+{
+    assert(num_candidates > 0);
+    std::vector<std::size_t> remaining;
+    if (config.num_exact) {
+        std::vector<double> approx(num_candidates);
+        for (std::size_t i = 0; i < num_candidates; i++)
+            approx[i] = approx_score(i);
+        std::vector<double> sorted = approx;
+        std::sort(sorted.begin(), sorted.end(), std::greater<double>());
+        double cutoff = std::min(
+                sorted[std::min(config.num_exact, sorted.size()) - 1],
+                sorted[0] - config.rel_tol * std::abs(sorted[0]));
+        for (std::size_t i = 0; i < num_candidates; i++)
+            if (approx[i] >= cutoff)
+                remaining.push_back(i);
+    } else {
+        for (std::size_t i = 0; i < num_candidates; i++)
+            remaining.push_back(i);
+    }
+
+    std::size_t res = remaining[0];
+    best = exact_score(res);
+    for (std::size_t j = 1; j < remaining.size(); j++) {
+        mpq_class score = exact_score(remaining[j]);
+        if (best < score) {
+            best = std::move(score);
+            res = remaining[j];
+        }
+    }
+    return res;
+}
+
+// All choices, with the nu interval of 0 first
+static std::vector<BranchChoice> all_choices(const Sofa &s)
+{
+    std::vector<BranchChoice> res = {{0, false}};
+    for (std::size_t i = 0; i < s.n; i++) {
+        if (i != s.mu_fix_idx)
+            res.push_back({i, true});
+        if (i != 0)
+            res.push_back({i, false});
+    }
+    return res;
+}
+
+BranchChoice GreedyPolicy::choose(Sofa &s) const
+{
+    mpq_class gain;
+    BranchChoice res = choose(s, gain);
+    assert(gain > 0);
+    return res;
+}
+
+BranchChoice GreedyPolicy::choose(Sofa &s, mpq_class &gain) const
+{
+    struct Candidate {
+        std::size_t idx;
+        HalveType t;
+    };
+    std::vector<Candidate> candidates;
+    for (std::size_t i = 0; i < s.n; i++) {
+        for (auto t : {kMuDown, kMuUp, kNuDown, kNuUp}) {
+            if (i == s.mu_fix_idx && Sofa::is_mu(t))
+                continue;
+            candidates.push_back({i, t});
+        }
+    }
+    // (0, kNuDown) goes first as it wins ties
+    std::stable_partition(candidates.begin(), candidates.end(),
+            [](const Candidate &c) { return c.idx == 0 && c.t == kNuDown; });
+
+    ApproxPolygons approx;
+    if (config.num_exact)
+        approx = s.approx_polygons();
+    std::size_t best = best_candidate(candidates.size(),
+            [&](std::size_t i) {
+                return s.approx_halve_gain(
+                        approx, candidates[i].idx, candidates[i].t);
+            },
+            [&](std::size_t i) {
+                return s.halve_gain(candidates[i].idx, candidates[i].t);
+            },
+            config, gain);
+    return {candidates[best].idx, Sofa::is_mu(candidates[best].t)};
+}
+
+BranchChoice MaxMinPolicy::choose(Sofa &s) const
+{
+    std::vector<BranchChoice> choices = all_choices(s);
+    ApproxPolygons approx;
+    if (config.num_exact)
+        approx = s.approx_polygons();
+    double w = max_weight.get_d();
+    mpq_class score;
+    std::size_t best = best_candidate(choices.size(),
+            [&](std::size_t i) {
+                const BranchChoice &c = choices[i];
+                double gd = s.approx_halve_gain(approx, c.idx, c.down());
+                double gu = s.approx_halve_gain(approx, c.idx, c.up());
+                return (1 - w) * std::min(gd, gu) + w * std::max(gd, gu);
+            },
+            [&](std::size_t i) {
+                const BranchChoice &c = choices[i];
+                mpq_class gd = s.halve_gain(c.idx, c.down());
+                mpq_class gu = s.halve_gain(c.idx, c.up());
+                if (gu < gd)
+                    std::swap(gd, gu);
+                return mpq_class((1 - max_weight) * gd + max_weight * gu);
+            },
+            config, score);
+    if (score > 0)
+        return choices[best];
+    return GreedyPolicy(config).choose(s);
+}
+
+BranchChoice LookaheadPolicy::choose(Sofa &s) const
+{
+    if (s.depth >= max_depth)
+        return greedy.choose(s);
+
+    // the choices of largest gain of one child,
+    // in the order of all_choices among equals
+    std::vector<BranchChoice> choices = all_choices(s);
+    std::vector<mpq_class> gains;
+    for (const auto &c : choices) {
+        mpq_class gd = s.halve_gain(c.idx, c.down());
+        mpq_class gu = s.halve_gain(c.idx, c.up());
+        gains.push_back(gd < gu ? gu : gd);
+    }
+    std::vector<std::size_t> order(choices.size());
+    for (std::size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+            [&](std::size_t i, std::size_t j) { return gains[j] < gains[i]; });
+    order.resize(std::min(width, order.size()));
+
+    // smaller area removed from the two children in two levels
+    std::size_t best = order[0];
+    mpq_class best_score = -1;
+    for (std::size_t i : order) {
+        const BranchChoice &c = choices[i];
+        Sofa sd(s, c.idx, c.down());
+        Sofa su(s, c.idx, c.up());
+        mpq_class gd, gu;
+        greedy.choose(sd, gd);
+        greedy.choose(su, gu);
+        mpq_class score_d = s.area() - sd.area() + gd;
+        mpq_class score_u = s.area() - su.area() + gu;
+        mpq_class score = (score_d < score_u ? score_d : score_u);
+        if (best_score < score) {
+            best_score = std::move(score);
+            best = i;
+        }
+    }
+    if (gains[best] > 0)
+        return choices[best];
+    return greedy.choose(s);
+}
+
+RecordedPolicy::RecordedPolicy(
+        const std::vector< std::vector<unsigned long long> > &choice_depths,
+        std::shared_ptr<const BranchingPolicy> fallback) :
+    codes(choice_depths.size(), -1),
+    fallback(fallback)
+{
+    assert(fallback);
+    for (std::size_t d = 0; d < choice_depths.size(); d++) {
+        unsigned long long most = 0;
+        for (std::size_t k = 0; k < choice_depths[d].size(); k++) {
+            if (most < choice_depths[d][k]) {
+                most = choice_depths[d][k];
+                codes[d] = k;
+            }
+        }
+    }
+}
+
+// An approximate gain above this is surely nonzero, so that a recorded 
+// choice with such a gain cuts something off without an exact gain. 
+// It is a margin on an area estimate, unlike the margin 
+// of inherit_gains, which is a distance between points.
+static const double kMinSureGain = 1e-9;
+
+BranchChoice RecordedPolicy::choose(Sofa &s) const
+{
+    if (s.depth < codes.size() && codes[s.depth] >= 0) {
+        BranchChoice c = BranchChoice::from_code(codes[s.depth]);
+        if (c.idx < s.n && !(c.is_mu && c.idx == s.mu_fix_idx)) {
+            ApproxPolygons approx = s.approx_polygons();
+            if (std::max(s.approx_halve_gain(approx, c.idx, c.down()),
+                        s.approx_halve_gain(approx, c.idx, c.up())) > kMinSureGain)
+                return c;
+            if (s.halve_gain(c.idx, c.down()) > 0 ||
+                    s.halve_gain(c.idx, c.up()) > 0)
+                return c;
+        }
+    }
+    return fallback->choose(s);
+}
+
+std::size_t RecordedPolicy::num_recorded() const
+{
+    std::size_t res = 0;
+    for (long c : codes)
+        if (c >= 0)
+            res++;
+    return res;
+}
+
+}; // namespace search
+}; // namespace sofa_designer
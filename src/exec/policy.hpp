@@ -0,0 +1,137 @@
+#ifndef POLICY_HPP
+#define POLICY_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include <gmpxx.h>
+
+#include "sofa.hpp"
+
+namespace sofa_designer {
+namespace search {
+
+using sofa::Sofa;
+using sofa::HalveType;
+
+// How the policies rank candidates by their gains
+struct BranchConfig {
+    // Candidates are first ranked by floating-point estimates
+    // of their gains. Exact gains are then computed for the best
+    // num_exact candidates and for all candidates whose estimate is
+    // within rel_tol of the best estimate, and the best of those
+    // is taken. num_exact == 0 computes every gain exactly.
+    // The screen is a heuristic: when gains are tiny, the rounding 
+    // error may exceed the window and drop the exact best candidate.
+    std::size_t num_exact;
+    double rel_tol;
+
+    BranchConfig() :
+        num_exact(1),
+        rel_tol(1e-9)
+    {
+    }
+};
+
+// Branching halves the mu interval of idx if is_mu,
+// the nu interval otherwise, into two children
+struct BranchChoice {
+    std::size_t idx;
+    bool is_mu;
+
+    HalveType down() const {return is_mu ? sofa::kMuDown : sofa::kNuDown;}
+    HalveType up() const {return is_mu ? sofa::kMuUp : sofa::kNuUp;}
+
+    // index of the choice in the histograms of SearchStats
+    std::size_t code() const {return 2*idx + (is_mu ? 0 : 1);}
+    static BranchChoice from_code(std::size_t code) {
+        return {code / 2, code % 2 == 0};
+    }
+};
+
+// Decides how to branch a sofa.
+// The same policy is shared by all workers, so choose() should be
+// safe to call from several threads on different sofas.
+class BranchingPolicy {
+    public:
+        virtual ~BranchingPolicy() = default;
+
+        virtual BranchChoice choose(Sofa &s) const = 0;
+};
+
+// Maximizes the gain of one of the two children
+class GreedyPolicy : public BranchingPolicy {
+    public:
+        BranchConfig config;
+
+        GreedyPolicy(const BranchConfig &config = BranchConfig()) :
+            config(config) {}
+
+        BranchChoice choose(Sofa &s) const;
+        // same, also giving the gain of the choice
+        BranchChoice choose(Sofa &s, mpq_class &gain) const;
+};
+
+// Maximizes the smaller gain of the two children, mixed with 
+// the larger one by max_weight, as the score of strong branching 
+// in MIP solvers. With max_weight == 0 the search can go arbitrarily 
+// deep along halvings whose two gains shrink geometrically, 
+// while some other halving would close one of the children.
+class MaxMinPolicy : public BranchingPolicy {
+    public:
+        BranchConfig config;
+        // in [0, 1]; 1 is GreedyPolicy
+        mpq_class max_weight;
+
+        MaxMinPolicy(
+                const BranchConfig &config = BranchConfig(),
+                const mpq_class &max_weight = mpq_class(1, 6)) :
+            config(config), max_weight(max_weight) {}
+
+        BranchChoice choose(Sofa &s) const;
+};
+
+// At depths below max_depth, tries the `width` choices of largest
+// greedy gain: for each, both children are built and branched greedily
+// in turn, and the choice that maximizes the smaller total gain of
+// the two levels is taken. GreedyPolicy at larger depths.
+class LookaheadPolicy : public BranchingPolicy {
+    public:
+        GreedyPolicy greedy;
+        std::size_t max_depth;
+        std::size_t width;
+
+        LookaheadPolicy(
+                const BranchConfig &config = BranchConfig(),
+                std::size_t max_depth = 8,
+                std::size_t width = 4) :
+            greedy(config), max_depth(max_depth), width(width) {}
+
+        BranchChoice choose(Sofa &s) const;
+};
+
+// Replays, at each depth, the choice made most often there
+// by an earlier search (SearchStats::choice_depths),
+// as long as it gains some area. Asks `fallback` otherwise.
+class RecordedPolicy : public BranchingPolicy {
+    public:
+        RecordedPolicy(
+                const std::vector< std::vector<unsigned long long> > &choice_depths,
+                std::shared_ptr<const BranchingPolicy> fallback);
+
+        BranchChoice choose(Sofa &s) const;
+
+        // number of depths with a recorded choice
+        std::size_t num_recorded() const;
+
+    private:
+        // code of the choice at each depth, or -1 for none
+        std::vector<long> codes;
+        std::shared_ptr<const BranchingPolicy> fallback;
+};
+
+}; // namespace search
+}; // namespace sofa_designer
+
+#endif // POLICY_HPP
@@ -0,0 +1,124 @@
+#include "profile.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+namespace sofa_designer {
+namespace profile {
+
+const char *timer_name(TimerId id)
+{
+    switch (id) {
+        case kBranch: return "branch";
+        case kHalveGain: return "halve_gain";
+        case kInheritGains: return "inherit_gains";
+        case kRegionClip: return "region_clip";
+        case kContextBranch: return "context_branch";
+        case kCalcArea: return "calc_area";
+        case kSofaChild: return "sofa_child";
+        case kSofaFree: return "sofa_free";
+        default: return "?";
+    }
+}
+
+const char *counter_name(CounterId id)
+{
+    switch (id) {
+        case kArrangementCached: return "arrangement_cached";
+        case kArrangementFiltered: return "arrangement_filtered";
+        case kArrangementExact: return "arrangement_exact";
+        case kGainKept: return "gain_kept";
+        case kGainDropped: return "gain_dropped";
+        case kIntersectionShared: return "intersection_shared";
+        case kIntersectionComputed: return "intersection_computed";
+        case kAreaFiltered: return "area_filtered";
+        case kAreaExact: return "area_exact";
+        default: return "?";
+    }
+}
+
+void Counters::clear()
+{
+    for (std::size_t i = 0; i < kNumTimers; i++)
+        ticks[i] = calls[i] = 0;
+    for (std::size_t i = 0; i < kNumCounters; i++)
+        counts[i] = 0;
+}
+
+void Counters::merge(const Counters &other)
+{
+    for (std::size_t i = 0; i < kNumTimers; i++) {
+        ticks[i] += other.ticks[i];
+        calls[i] += other.calls[i];
+    }
+    for (std::size_t i = 0; i < kNumCounters; i++)
+        counts[i] += other.counts[i];
+}
+
+Counters &thread_counters()
+{
+    thread_local static Counters counters;
+    return counters;
+}
+
+double ticks_per_second()
+{
+    static double tps = []() {
+        typedef std::chrono::steady_clock Clock;
+        auto t0 = Clock::now();
+        unsigned long long k0 = ticks();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        unsigned long long k1 = ticks();
+        auto t1 = Clock::now();
+        return (k1 - k0) / std::chrono::duration<double>(t1 - t0).count();
+    }();
+    return tps;
+}
+
+void print_table(std::ostream &out, 
+        const Counters &c, double busy_time)
+{
+    char buf[128];
+    double tps = ticks_per_second();
+    std::snprintf(buf, sizeof(buf), "%-16s %14s %12s %12s %10s\n",
+            "timer", "calls", "seconds", "ns/call", "% busy");
+    out << buf;
+    for (std::size_t i = 0; i < kNumTimers; i++) {
+        double sec = c.ticks[i] / tps;
+        std::snprintf(buf, sizeof(buf), "%-16s %14llu %12.3f %12.1f %10.1f\n",
+                timer_name(TimerId(i)), c.calls[i], sec,
+                c.calls[i] ? sec / c.calls[i] * 1e9 : 0.0,
+                busy_time > 0 ? sec / busy_time * 100 : 0.0);
+        out << buf;
+    }
+    std::snprintf(buf, sizeof(buf), "\n%-20s %14s\n", "counter", "count");
+    out << buf;
+    for (std::size_t i = 0; i < kNumCounters; i++) {
+        std::snprintf(buf, sizeof(buf), "%-20s %14llu\n",
+                counter_name(CounterId(i)), c.counts[i]);
+        out << buf;
+    }
+}
+
+void print_json(std::ostream &out, 
+        const Counters &c, double wall_time, unsigned long long num_iter)
+{
+    double tps = ticks_per_second();
+    out << "{\"wall_time\":" << wall_time << ",\"iter\":" << num_iter;
+    out << ",\"timers\":{";
+    for (std::size_t i = 0; i < kNumTimers; i++) {
+        out << (i ? "," : "") << "\"" << timer_name(TimerId(i)) << "\":";
+        out << "{\"calls\":" << c.calls[i] << 
+            ",\"seconds\":" << c.ticks[i] / tps << "}";
+    }
+    out << "},\"counters\":{";
+    for (std::size_t i = 0; i < kNumCounters; i++) {
+        out << (i ? "," : "") << "\"" << counter_name(CounterId(i)) << "\":";
+        out << c.counts[i];
+    }
+    out << "}}" << std::endl;
+}
+
+}; // namespace profile
+}; // namespace sofa_designer
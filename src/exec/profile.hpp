@@ -0,0 +1,128 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include <cstddef>
+#include <ostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+// Hot-path instrumentation, compiled in only with -DSOFA_PROFILE
+// (`make PROFILE=1`). Each thread accumulates into its own Counters
+// without synchronization; the search collects them at batch boundaries.
+//
+// SOFA_PROFILE_SCOPE(kTimer) times the rest of the enclosing scope
+// SOFA_PROFILE_COUNT(kCounter) increments a counter
+
+namespace sofa_designer {
+namespace profile {
+
+#ifdef SOFA_PROFILE
+const bool kEnabled = true;
+#else
+const bool kEnabled = false;
+#endif
+
+// Timers are inclusive: kHalveGain contains the kRegionClip it calls
+enum TimerId {
+    kBranch,        // search::branch, or the choice of a worker
+    kHalveGain,     // Sofa::calc_halve_gain
+    kInheritGains,  // Sofa::inherit_gains
+    kRegionClip,    // *Region::intersection of one polygon
+    kContextBranch, // SofaLineContext branching constructor
+    kCalcArea,      // Sofa::calc_area of polygons
+    kSofaChild,     // new Sofa(parent, idx, t), or one from a SofaPool
+    kSofaFree,      // delete of a Sofa, or its return to a SofaPool
+    kNumTimers
+};
+
+enum CounterId {
+    kArrangementCached, // SofaLineContext::arrangement answered by cache
+    kArrangementFiltered, // ... by the floating-point filter
+    kArrangementExact,  // ... that needed an exact predicate
+    kGainKept,          // cached halve gain a child kept from its parent
+    kGainDropped,       // ... that the child had to drop
+    kIntersectionShared,   // intersection found in the IntersectionStore
+    kIntersectionComputed, // ... that had to be computed
+    kAreaFiltered,      // Sofa::area_below answered by the estimate
+    kAreaExact,         // exact area computed by Sofa::area
+    kNumCounters
+};
+
+const char *timer_name(TimerId id);
+const char *counter_name(CounterId id);
+
+struct Counters {
+    unsigned long long ticks[kNumTimers];
+    unsigned long long calls[kNumTimers];
+    unsigned long long counts[kNumCounters];
+
+    Counters() { clear(); }
+    void clear();
+    void merge(const Counters &other);
+};
+
+// The counters of the calling thread
+Counters &thread_counters();
+
+inline unsigned long long ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+// Measured once against steady_clock
+double ticks_per_second();
+
+class ScopedTimer {
+    public:
+        ScopedTimer(TimerId id) : id(id), start(ticks()) {}
+        ~ScopedTimer()
+        {
+            Counters &c = thread_counters();
+            c.ticks[id] += ticks() - start;
+            c.calls[id]++;
+        }
+        ScopedTimer(const ScopedTimer &other) = delete;
+        ScopedTimer &operator=(const ScopedTimer &other) = delete;
+
+    private:
+        TimerId id;
+        unsigned long long start;
+};
+
+// Table of calls, seconds and share of `busy_time` per timer,
+// followed by the counters. `busy_time` is the sum of the running
+// times of all threads that contributed to `c`.
+void print_table(std::ostream &out, 
+        const Counters &c, double busy_time);
+// One JSON object on a single line
+void print_json(std::ostream &out, 
+        const Counters &c, double wall_time, unsigned long long num_iter);
+
+}; // namespace profile
+}; // namespace sofa_designer
+
+#define SOFA_PROFILE_CONCAT_IMPL(a, b) a##b
+#define SOFA_PROFILE_CONCAT(a, b) SOFA_PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef SOFA_PROFILE
+#define SOFA_PROFILE_SCOPE(timer) \
+    ::sofa_designer::profile::ScopedTimer \
+        SOFA_PROFILE_CONCAT(profile_timer_, __LINE__)( \
+                ::sofa_designer::profile::timer)
+#define SOFA_PROFILE_COUNT(counter) \
+    (::sofa_designer::profile::thread_counters().counts[ \
+     ::sofa_designer::profile::counter]++)
+#else
+#define SOFA_PROFILE_SCOPE(timer) ((void)0)
+#define SOFA_PROFILE_COUNT(counter) ((void)0)
+#endif
+
+#endif // PROFILE_HPP
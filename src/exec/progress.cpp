@@ -0,0 +1,126 @@
+#include "progress.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+namespace sofa_designer {
+namespace search {
+
+double ProgressSnapshot::eta() const
+{
+    if (closed_volume <= 0 || elapsed <= 0)
+        return -1;
+    return (1 - closed_volume) * elapsed / closed_volume;
+}
+
+ProgressReporter::ProgressReporter(
+        std::size_t num_workers,
+        std::size_t num_roots,
+        double interval,
+        std::ostream &out) :
+    num_workers(num_workers),
+    num_roots(num_roots),
+    metrics(new WorkerMetrics[num_workers]),
+    interval(interval),
+    out(out),
+    start_time(Clock::now()),
+    stopped(interval <= 0)
+{
+    for (std::size_t i = 0; i < num_workers; i++)
+        metrics[i].init_roots(num_roots);
+    if (!stopped)
+        reporter = std::thread(&ProgressReporter::run, this);
+}
+
+ProgressReporter::~ProgressReporter()
+{
+    stop();
+}
+
+ProgressSnapshot ProgressReporter::snapshot() const
+{
+    const auto relaxed = std::memory_order_relaxed;
+    ProgressSnapshot snap;
+    snap.elapsed = 
+        std::chrono::duration<double>(Clock::now() - start_time).count();
+    snap.num_iter = snap.stack_size = snap.num_closed = 0;
+    snap.min_area = snap.max_area = snap.closed_volume = 0;
+    snap.root_closed_volume.assign(num_roots, 0);
+    bool any_stack = false;
+    for (std::size_t i = 0; i < num_workers; i++) {
+        const WorkerMetrics &m = metrics[i];
+        snap.num_iter += m.num_iter.load(relaxed);
+        snap.num_closed += m.num_closed.load(relaxed);
+        for (std::size_t r = 0; r < num_roots; r++)
+            snap.root_closed_volume[r] += m.root_closed_volume[r].load(relaxed);
+        if (m.stack_size.load(relaxed)) {
+            double lo = m.min_area.load(relaxed);
+            double hi = m.max_area.load(relaxed);
+            snap.min_area = any_stack ? std::min(snap.min_area, lo) : lo;
+            snap.max_area = any_stack ? std::max(snap.max_area, hi) : hi;
+            snap.stack_size += m.stack_size.load(relaxed);
+            any_stack = true;
+        }
+    }
+    for (std::size_t r = 0; r < num_roots; r++)
+        snap.closed_volume += snap.root_closed_volume[r] / num_roots;
+    return snap;
+}
+
+void ProgressReporter::print(const ProgressSnapshot &snap)
+{
+    std::ostringstream line;
+    line << "{\"progress\":{\"elapsed\":" << snap.elapsed <<
+        ",\"iter\":" << snap.num_iter <<
+        ",\"iter_per_sec\":" << 
+        (snap.elapsed > 0 ? snap.num_iter / snap.elapsed : 0.0) <<
+        ",\"stack\":" << snap.stack_size <<
+        ",\"min_area\":" << snap.min_area <<
+        ",\"max_area\":" << snap.max_area <<
+        ",\"closed\":" << snap.num_closed <<
+        ",\"closed_volume\":" << snap.closed_volume <<
+        ",\"volume_per_sec\":" << 
+        (snap.elapsed > 0 ? snap.closed_volume / snap.elapsed : 0.0) <<
+        ",\"eta\":" << snap.eta() << 
+        ",\"root_closed_volume\":[";
+    for (std::size_t r = 0; r < snap.root_closed_volume.size(); r++)
+        line << (r ? "," : "") << snap.root_closed_volume[r];
+    line << "]}}\n";
+    write(line.str());
+}
+
+void ProgressReporter::write(const std::string &line)
+{
+    std::lock_guard<std::mutex> lock(out_mtx);
+    out << line << std::flush;
+}
+
+void ProgressReporter::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (stopped)
+            return;
+        stopped = true;
+    }
+    cv.notify_all();
+    reporter.join();
+    print(snapshot());
+}
+
+void ProgressReporter::run()
+{
+    const auto period = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(interval));
+    auto next_time = start_time + period;
+    std::unique_lock<std::mutex> lock(mtx);
+    while (!stopped) {
+        if (cv.wait_until(lock, next_time) == std::cv_status::timeout) {
+            print(snapshot());
+            next_time += period;
+        }
+    }
+}
+
+}; // namespace search
+}; // namespace sofa_designer
@@ -0,0 +1,118 @@
+#ifndef PROGRESS_HPP
+#define PROGRESS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sofa_designer {
+namespace search {
+
+// Progress of one worker. Each field has a single writer 
+// (the worker owning the slot) and is read by the reporter,
+// so plain relaxed atomic loads and stores suffice.
+struct WorkerMetrics {
+    std::atomic<unsigned long long> num_iter;
+    // sofas on the stack of the worker and the range of their areas
+    std::atomic<unsigned long long> stack_size;
+    std::atomic<double> min_area, max_area;
+    // sofas closed by the target and, for each initial sofa,
+    // the fraction of its box that the closed boxes cover
+    std::atomic<unsigned long long> num_closed;
+    std::unique_ptr< std::atomic<double>[] > root_closed_volume;
+
+    WorkerMetrics() :
+        num_iter(0), stack_size(0), 
+        min_area(0), max_area(0),
+        num_closed(0)
+    {
+    }
+
+    void init_roots(std::size_t num_roots)
+    {
+        root_closed_volume.reset(new std::atomic<double>[num_roots]);
+        for (std::size_t r = 0; r < num_roots; r++)
+            root_closed_volume[r].store(0);
+    }
+
+    // for the single writer
+    template <typename T>
+    static void add(std::atomic<T> &a, T v)
+    {
+        a.store(a.load(std::memory_order_relaxed) + v, 
+                std::memory_order_relaxed);
+    }
+};
+
+// Sum of all WorkerMetrics at one moment
+struct ProgressSnapshot {
+    double elapsed;
+    unsigned long long num_iter;
+    unsigned long long stack_size;
+    double min_area, max_area;
+    unsigned long long num_closed;
+    std::vector<double> root_closed_volume;
+    // fraction of the whole parameter space
+    double closed_volume;
+
+    // Seconds left assuming the closed volume keeps growing 
+    // at its average rate so far; negative if unknown
+    double eta() const;
+};
+
+// Owns one WorkerMetrics per worker and a thread that writes 
+// a JSON line of their sum every `interval` seconds
+// until it is stopped or destroyed.
+// Other lines written to the same stream while it runs 
+// should go through write(), so that no two lines interleave.
+// The initial sofas are assumed to split the parameter space 
+// into num_roots parts of equal volume.
+class ProgressReporter {
+    public:
+        ProgressReporter(
+                std::size_t num_workers,
+                std::size_t num_roots,
+                double interval, 
+                std::ostream &out);
+        ~ProgressReporter();
+        ProgressReporter(const ProgressReporter &other) = delete;
+        ProgressReporter &operator=(const ProgressReporter &other) = delete;
+
+        WorkerMetrics &worker(std::size_t idx) { return metrics[idx]; }
+        ProgressSnapshot snapshot() const;
+        void print(const ProgressSnapshot &snap);
+        // Writes `line` to the stream as a whole
+        void write(const std::string &line);
+        // Writes a last line and joins the reporting thread
+        void stop();
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        std::size_t num_workers, num_roots;
+        std::unique_ptr<WorkerMetrics[]> metrics;
+        double interval;
+        std::ostream &out;
+        Clock::time_point start_time;
+        // held while writing a line to out
+        std::mutex out_mtx;
+
+        std::mutex mtx;
+        std::condition_variable cv;
+        bool stopped;
+        std::thread reporter;
+
+        void run();
+};
+
+}; // namespace search
+}; // namespace sofa_designer
+
+#endif // PROGRESS_HPP
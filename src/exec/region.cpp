@@ -1,5 +1,8 @@
 #include "region.hpp"
 
+#include "profile.hpp"
+#include "sofa_line_context.hpp"
+
 #include <algorithm>
 #include <cassert>
 #include <iostream>
@@ -7,17 +10,39 @@
 namespace sofa_designer {
 namespace geometry { 
 
-Polygons Region::intersection(const Polygons &polys) const
+// Clips each polygon in turn into out
+template <class R>
+static void intersect_each(const R &region, const Polygons &polys, Polygons &out)
 {
-    Polygons res;
-    for (Polygon p : polys) {
-        Polygons to_add = intersection(p);
-        res.insert(res.end(), to_add.begin(), to_add.end());
+    assert(&polys != &out);
+    out.clear();
+    for (const Polygon &p : polys)
+        region.intersection(p, out);
+}
+
+// Sorts the polylines of one clip, of which there are rarely more than
+// three. Each comparison is an arrangement query, and insertion sort 
+// compares each pair at most once, unlike std::sort.
+const std::size_t kSmallSortMax = 16;
+
+template <class T, class Comp>
+static void small_sort(T *first, T *last, Comp comp)
+{
+    if (std::size_t(last - first) > kSmallSortMax) {
+        std::sort(first, last, comp);
+        return;
+    }
+    for (T *i = first + 1; i < last; i++) {
+        T v = *i;
+        T *j = i;
+        for (; j != first && comp(v, *(j - 1)); j--)
+            *j = *(j - 1);
+        *j = v;
     }
-    return res;
 }
 
-bool HalfPlaneRegion::contains_intersection(LineId l0, LineId l1) const
+template <class Context>
+bool HalfPlaneRegion<Context>::contains_intersection(LineId l0, LineId l1) const
 {
     if (l0 < 0)
         l0 = ~l0;
@@ -47,13 +72,13 @@ bool HalfPlaneRegion::contains_intersection(LineId l0, LineId l1) const
         below_l = (l1 < l);
     } else if (l < l0) {
         // l < l0 < l1
-        below_l = (const_cast<LineContext&>(ctx).arrangement(l, l0, l1) == kV);
+        below_l = (ctx.arrangement(l, l0, l1) == kV);
     } else if (l1 < l) {
         // l0 < l1 < l
-        below_l = (const_cast<LineContext&>(ctx).arrangement(l0, l1, l) == kV);
+        below_l = (ctx.arrangement(l0, l1, l) == kV);
     } else {
         // l0 < l < l1
-        below_l = (const_cast<LineContext&>(ctx).arrangement(l0, l, l1) == kU);
+        below_l = (ctx.arrangement(l0, l, l1) == kU);
     }
 
     if (boundary_id >= 0)
@@ -62,7 +87,8 @@ bool HalfPlaneRegion::contains_intersection(LineId l0, LineId l1) const
         return below_l;
 }
 
-std::size_t HalfPlaneRegion::build_polylines(
+template <class Context>
+std::size_t HalfPlaneRegion<Context>::build_polylines(
         const Polygon &poly,
         Polyline *polylines) const
 {
@@ -106,21 +132,27 @@ std::size_t HalfPlaneRegion::build_polylines(
     return cur_polyline - polylines;
 }
 
-void HalfPlaneRegion::link_polylines(
+template <class Context>
+void HalfPlaneRegion<Context>::link_polylines(
         Polyline *polylines,
         std::size_t num_polylines) const
 {
+    if (num_polylines == 1) {
+        polylines[0].nxt_polyline = polylines;
+        return;
+    }
+
     Polyline *pl_srt_b[num_polylines];
     Polyline *pl_srt_e[num_polylines];
     for (int i = 0; i < num_polylines; i++)
         pl_srt_b[i] = pl_srt_e[i] = polylines + i;
 
-    std::sort(pl_srt_b, pl_srt_b + num_polylines, 
+    small_sort(pl_srt_b, pl_srt_b + num_polylines, 
             [this](const Polyline * pl0, const Polyline * pl1){
             // line enters the region, so reverse the line value to make it go out of region
             return comp_line_out(~(pl0->begin_value), ~(pl1->begin_value));
             });
-    std::sort(pl_srt_e, pl_srt_e + num_polylines, 
+    small_sort(pl_srt_e, pl_srt_e + num_polylines, 
             [this](const Polyline * pl0, const Polyline * pl1){
             // line exits the region, so the line is aligned to the out direction from region
             return comp_line_out(pl0->end_value, pl1->end_value);
@@ -131,16 +163,17 @@ void HalfPlaneRegion::link_polylines(
 
 }
 
-Polygons HalfPlaneRegion::make_polygons(
+template <class Context>
+void HalfPlaneRegion<Context>::make_polygons(
         const Polygon &poly,
         Polyline *polylines,
-        std::size_t num_polylines) const
+        std::size_t num_polylines,
+        Polygons &out) const
 {
-        Polygons polygons;
-
         for (int i = 0; i < num_polylines; i++)
             if (!polylines[i].visited) {
-                Polygon cur_polygon;
+                out.emplace_back();
+                Polygon &cur_polygon = out.back();
                 Polyline *cur_polyline = polylines + i;
                 while (!cur_polyline->visited) {
                     cur_polyline->visited = true;
@@ -158,17 +191,17 @@ Polygons HalfPlaneRegion::make_polygons(
                     cur_polygon.push_back(boundary_id);
                     cur_polyline = cur_polyline->nxt_polyline;
                 }
-
-                polygons.push_back(std::move(cur_polygon));
             }
-
-        return polygons;
 }
 
-Polygons HalfPlaneRegion::intersection(const Polygon &poly) const
+template <class Context>
+void HalfPlaneRegion<Context>::intersection(
+        const Polygon &poly, 
+        Polygons &out) const
 {
+    SOFA_PROFILE_SCOPE(kRegionClip);
     if (!poly.size())
-        return {};
+        return;
 
     assert(poly.size() >= std::size_t(3));
 
@@ -178,19 +211,42 @@ Polygons HalfPlaneRegion::intersection(const Polygon &poly) const
     if (num_polylines == 0) {
         // nothing has written: neither out or in
         if (contains_intersection(poly[0], poly[1]))
-            return {poly};
-        else
-            return {};
+            out.push_back(poly);
+    } else if (num_polylines == 1) {
+        // the boundary crosses the polygon once, which is the usual case.
+        // the result is the polygon rotated to start at the entering edge,
+        // cut after the exiting edge and closed by the boundary.
+        const Polyline &pl = polylines[0];
+        out.emplace_back();
+        Polygon &res = out.back();
+        if (pl.begin <= pl.end) {
+            res.reserve(pl.end - pl.begin + 2);
+            res.insert(res.end(), pl.begin, pl.end + 1);
+        } else {
+            res.reserve(poly.size() - (pl.begin - pl.end) + 2);
+            res.insert(res.end(), pl.begin, poly.data() + poly.size());
+            res.insert(res.end(), poly.data(), pl.end + 1);
+        }
+        res.push_back(boundary_id);
     } else {
         link_polylines(polylines, num_polylines);
-        return make_polygons(poly, polylines, num_polylines);
+        make_polygons(poly, polylines, num_polylines, out);
     }
 }
 
-UnionOfTwoHalfPlanesRegion::UnionOfTwoHalfPlanesRegion(
-        const LineContext &ctx,
+template <class Context>
+Polygons HalfPlaneRegion<Context>::intersection(const Polygon &poly) const
+{
+    Polygons res;
+    intersection(poly, res);
+    return res;
+}
+
+template <class Context>
+UnionOfTwoHalfPlanesRegion<Context>::UnionOfTwoHalfPlanesRegion(
+        const Context &ctx,
         LineId bd0, LineId bd1) :
-    Region(ctx), bd0(bd0), bd1(bd1)
+    ctx(ctx), bd0(bd0), bd1(bd1)
 {
     bool flip = ((bd0 < 0) != (bd1 < 0));
     // make everything unsigned
@@ -201,7 +257,8 @@ UnionOfTwoHalfPlanesRegion::UnionOfTwoHalfPlanesRegion(
     // std::cout << this->bd0 << " " << this->bd1 << " bd0 bd1" << std::endl;
 }
 
-std::size_t UnionOfTwoHalfPlanesRegion::build_polylines(
+template <class Context>
+std::size_t UnionOfTwoHalfPlanesRegion<Context>::build_polylines(
         const Polygon &poly,
         Polyline *polylines) const
 {
@@ -231,7 +288,7 @@ std::size_t UnionOfTwoHalfPlanesRegion::build_polylines(
                 type = kH0;
             else {
                 assert(m != bd0 && m != bd1 && m != ~bd0 && m != ~bd1);
-                if (HalfPlaneRegion(ctx, m).contains_intersection(bd0, bd1))
+                if (HalfPlaneRegion<Context>(ctx, m).contains_intersection(bd0, bd1))
                     type = kH1;
                 else 
                     type = kH0;
@@ -249,7 +306,7 @@ std::size_t UnionOfTwoHalfPlanesRegion::build_polylines(
                 type = kH0;
             else {
                 assert(m != bd0 && m != bd1 && m != ~bd0 && m != ~bd1);
-                if (HalfPlaneRegion(ctx, m).contains_intersection(bd0, bd1))
+                if (HalfPlaneRegion<Context>(ctx, m).contains_intersection(bd0, bd1))
                     type = kH0;
                 else 
                     type = kH1;
@@ -264,7 +321,7 @@ std::size_t UnionOfTwoHalfPlanesRegion::build_polylines(
             assert(m != bd0 && m != bd1 && m != ~bd0 && m != ~bd1);
             if (p_in_h0) {
                 assert(p_in_h0 && !p_in_h1 && !q_in_h0 && q_in_h1);
-                if (HalfPlaneRegion(ctx, m).contains_intersection(bd0, bd1)) {
+                if (HalfPlaneRegion<Context>(ctx, m).contains_intersection(bd0, bd1)) {
                     // the line goes out and in
                     // going out
                     cur_polyline->end = &(poly[i]);
@@ -279,7 +336,7 @@ std::size_t UnionOfTwoHalfPlanesRegion::build_polylines(
                 }
             } else {
                 assert(!p_in_h0 && p_in_h1 && q_in_h0 && !q_in_h1);
-                if (!HalfPlaneRegion(ctx, m).contains_intersection(bd0, bd1)) {
+                if (!HalfPlaneRegion<Context>(ctx, m).contains_intersection(bd0, bd1)) {
                     // the line goes out and in
                     // going out
                     cur_polyline->end = &(poly[i]);
@@ -313,10 +370,17 @@ std::size_t UnionOfTwoHalfPlanesRegion::build_polylines(
     return cur_polyline - polylines;
 }
 
-void UnionOfTwoHalfPlanesRegion::link_polylines(
+template <class Context>
+void UnionOfTwoHalfPlanesRegion<Context>::link_polylines(
         Polyline *polylines,
         std::size_t num_polylines) const
 {
+    // a single polyline closes up with itself
+    if (num_polylines == 1) {
+        polylines[0].nxt_polyline = polylines;
+        return;
+    }
+
     Polyline *pl_b_h0[num_polylines];
     Polyline *pl_e_h0[num_polylines];
     Polyline *pl_b_h1[num_polylines];
@@ -339,20 +403,20 @@ void UnionOfTwoHalfPlanesRegion::link_polylines(
     }
 
     // polylines entering the region: so reverse direction
-    std::sort(pl_b_h0, pl_b_h0 + num_b_h0, 
+    small_sort(pl_b_h0, pl_b_h0 + num_b_h0, 
             [this](const Polyline * pl0, const Polyline * pl1){
             return comp_line_out_bd0(~(pl0->begin_value), ~(pl1->begin_value));
             });
-    std::sort(pl_b_h1, pl_b_h1 + num_b_h1, 
+    small_sort(pl_b_h1, pl_b_h1 + num_b_h1, 
             [this](const Polyline * pl0, const Polyline * pl1){
             return comp_line_out_bd1(~(pl0->begin_value), ~(pl1->begin_value));
             });
     // polylines exiting the region, no need to reverse
-    std::sort(pl_e_h0, pl_e_h0 + num_e_h0, 
+    small_sort(pl_e_h0, pl_e_h0 + num_e_h0, 
             [this](const Polyline * pl0, const Polyline * pl1){
             return comp_line_out_bd0(pl0->end_value, pl1->end_value);
             });
-    std::sort(pl_e_h1, pl_e_h1 + num_e_h1, 
+    small_sort(pl_e_h1, pl_e_h1 + num_e_h1, 
             [this](const Polyline * pl0, const Polyline * pl1){
             return comp_line_out_bd1(pl0->end_value, pl1->end_value);
             });
@@ -387,10 +451,12 @@ void UnionOfTwoHalfPlanesRegion::link_polylines(
     }
 }
 
-Polygons UnionOfTwoHalfPlanesRegion::make_polygons(
+template <class Context>
+void UnionOfTwoHalfPlanesRegion<Context>::make_polygons(
         const Polygon &poly,
         Polyline *polylines,
-        std::size_t num_polylines) const
+        std::size_t num_polylines,
+        Polygons &out) const
 {
     /*
     std::cout << polylines << std::endl;
@@ -398,11 +464,10 @@ Polygons UnionOfTwoHalfPlanesRegion::make_polygons(
     std::cout << polylines->nxt_polyline << std::endl;
     std::cout << (polylines + 1)->nxt_polyline << std::endl;
     */
-    Polygons polygons;
-
     for (int i = 0; i < num_polylines; i++)
         if (!polylines[i].visited) {
-            Polygon cur_polygon;
+            out.emplace_back();
+            Polygon &cur_polygon = out.back();
             Polyline *cur_polyline = polylines + i;
             while (!cur_polyline->visited) {
                 cur_polyline->visited = true;
@@ -451,16 +516,17 @@ Polygons UnionOfTwoHalfPlanesRegion::make_polygons(
 
                 cur_polyline = cur_polyline->nxt_polyline;
             }
-            polygons.push_back(std::move(cur_polygon));
         }
-
-    return polygons;
 }
 
-Polygons UnionOfTwoHalfPlanesRegion::intersection(const Polygon &poly) const
+template <class Context>
+void UnionOfTwoHalfPlanesRegion<Context>::intersection(
+        const Polygon &poly,
+        Polygons &out) const
 {
+    SOFA_PROFILE_SCOPE(kRegionClip);
     if (!poly.size())
-        return {};
+        return;
 
     assert(poly.size() >= std::size_t(3));
     Polyline polylines[poly.size() / 2 + 1];
@@ -476,14 +542,98 @@ Polygons UnionOfTwoHalfPlanesRegion::intersection(const Polygon &poly) const
         bool p_in_h1 = intersection_in_h1(l, m);
         bool p_in_region = p_in_h0 || p_in_h1;
         if (p_in_region)
-            return {poly};
-        else
-            return {};
+            out.push_back(poly);
     } else {
         link_polylines(polylines, num_polylines);
-        return make_polygons(poly, polylines, num_polylines);
+        make_polygons(poly, polylines, num_polylines, out);
+    }
+}
+
+template <class Context>
+Polygons UnionOfTwoHalfPlanesRegion<Context>::intersection(const Polygon &poly) const
+{
+    Polygons res;
+    intersection(poly, res);
+    return res;
+}
+
+template <class Context>
+Polygons HalfPlaneRegion<Context>::intersection(const Polygons &polys) const
+{
+    Polygons res;
+    intersect_each(*this, polys, res);
+    return res;
+}
+
+template <class Context>
+void HalfPlaneRegion<Context>::intersection(
+        const Polygons &polys,
+        Polygons &out) const
+{
+    intersect_each(*this, polys, out);
+}
+
+template <class Context>
+Polygons UnionOfTwoHalfPlanesRegion<Context>::intersection(const Polygons &polys) const
+{
+    Polygons res;
+    intersect_each(*this, polys, res);
+    return res;
+}
+
+template <class Context>
+void UnionOfTwoHalfPlanesRegion<Context>::intersection(
+        const Polygons &polys,
+        Polygons &out) const
+{
+    intersect_each(*this, polys, out);
+}
+
+template <class Context>
+Polygons RegionSequence<Context>::intersection(const Polygons &polys) const
+{
+    Polygons res;
+    intersection(polys, res);
+    return res;
+}
+
+template <class Context>
+void RegionSequence<Context>::intersection(
+        const Polygons &polys,
+        Polygons &out) const
+{
+    assert(&polys != &out);
+    if (steps.empty()) {
+        out = polys;
+        return;
     }
+
+    // alternate between out and scratch so that the last step 
+    // writes into out
+    Polygons scratch;
+    Polygons *bufs[2] = {&out, &scratch};
+    const Polygons *cur = &polys;
+    for (std::size_t i = 0; i < steps.size(); i++) {
+        const Step &s = steps[i];
+        Polygons &nxt = *bufs[(steps.size() - 1 - i) % 2];
+        if (s.is_union)
+            UnionOfTwoHalfPlanesRegion<Context>(ctx, s.bd0, s.bd1).intersection(*cur, nxt);
+        else
+            HalfPlaneRegion<Context>(ctx, s.bd0).intersection(*cur, nxt);
+        cur = &nxt;
+        if (cur->empty())
+            break;
+    }
+    if (cur != &out)
+        out = *cur;
 }
 
+template class HalfPlaneRegion<VanillaLineContext>;
+template class UnionOfTwoHalfPlanesRegion<VanillaLineContext>;
+template class RegionSequence<VanillaLineContext>;
+template class HalfPlaneRegion<sofa::SofaLineContext>;
+template class UnionOfTwoHalfPlanesRegion<sofa::SofaLineContext>;
+template class RegionSequence<sofa::SofaLineContext>;
+
 }; // namespace geometry
 }; // namespace sofa_designer
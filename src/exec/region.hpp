@@ -7,44 +7,47 @@
 #include "coord.hpp"
 #include "line.hpp"
 #include "line_context.hpp"
+#include "small_vector.hpp"
 
 namespace sofa_designer {
 namespace geometry {
 
-typedef std::vector<LineId> Polygon;
-typedef std::vector<Polygon> Polygons;
+// A polygon is the cyclic list of its edges, and the polygons of 
+// a sofa have at most a few dozen of them. Both levels keep their 
+// typical sizes inline, so that clipping a polygon does not allocate.
+typedef SmallVector<LineId, 32> Polygon;
+typedef SmallVector<Polygon, 2> Polygons;
 
-class Region {
-    public:
-        const LineContext &ctx;
-
-        Region() = delete;
-        Region &operator=(const Region &other) = delete;
-        Region &operator=(Region &&other) = delete;
-
-        Region(const LineContext &ctx) : ctx(ctx) {}
-        virtual ~Region() = default;
-
-        virtual Polygons intersection(const Polygon &poly) const = 0;
-        Polygons intersection(const Polygons &polys) const;
-};
+// Regions are templated on the line context, so that the calls to 
+// the context in the clipping loops are resolved at compile time.
+// They are instantiated in region.cpp for VanillaLineContext 
+// and for sofa::SofaLineContext.
 
 // The structure basically works as a wrapper around one LineId
 // The class represents a half-plane with supplied boundary
 // The boundary can either have nonnegative id or negative id
-class HalfPlaneRegion : public Region {
+template <class Context>
+class HalfPlaneRegion {
     public:
-        using Region::intersection;
+        const Context &ctx;
         LineId boundary_id;
 
+        HalfPlaneRegion() = delete;
+        HalfPlaneRegion &operator=(const HalfPlaneRegion &other) = delete;
+
         HalfPlaneRegion(
-                const LineContext &ctx, 
+                const Context &ctx, 
                 LineId boundary_id) : 
-            Region(ctx), boundary_id(boundary_id) {}
-        ~HalfPlaneRegion() = default;
+            ctx(ctx), boundary_id(boundary_id) {}
         bool contains_intersection(LineId l0, LineId l1) const;
 
         Polygons intersection(const Polygon &poly) const;
+        Polygons intersection(const Polygons &polys) const;
+        // Appends the part of poly in the region to out
+        void intersection(const Polygon &poly, Polygons &out) const;
+        // Clips polys into out, which is cleared first. Reusing one out
+        // across calls keeps its storage, so clipping does not allocate.
+        void intersection(const Polygons &polys, Polygons &out) const;
 
     private:
         struct Polyline {
@@ -62,10 +65,11 @@ class HalfPlaneRegion : public Region {
         void link_polylines(
                 Polyline *polylines,
                 std::size_t num_polylines) const;
-        Polygons make_polygons(
+        void make_polygons(
                 const Polygon &poly,
                 Polyline *polylines,
-                std::size_t num_polylines) const;
+                std::size_t num_polylines,
+                Polygons &out) const;
 
         // used to compare two 
         bool comp_line_out(LineId id0, LineId id1) const {
@@ -74,26 +78,34 @@ class HalfPlaneRegion : public Region {
 };
 
 // Better honest and clear and long when it comes to class names
-class UnionOfTwoHalfPlanesRegion : public Region {
+template <class Context>
+class UnionOfTwoHalfPlanesRegion {
     public:
-        using Region::intersection;
+        const Context &ctx;
         LineId bd0, bd1;
 
+        UnionOfTwoHalfPlanesRegion() = delete;
+        UnionOfTwoHalfPlanesRegion &operator=(
+                const UnionOfTwoHalfPlanesRegion &other) = delete;
+
         UnionOfTwoHalfPlanesRegion(
-                const LineContext &ctx,
+                const Context &ctx,
                 LineId bd0, LineId bd1);
-        ~UnionOfTwoHalfPlanesRegion() = default;
 
         bool intersection_in_h0(LineId l0, LineId l1) const
         {
-            return HalfPlaneRegion(ctx, bd0).contains_intersection(l0, l1);
+            return HalfPlaneRegion<Context>(ctx, bd0).contains_intersection(l0, l1);
         }
         bool intersection_in_h1(LineId l0, LineId l1) const
         {
-            return HalfPlaneRegion(ctx, bd1).contains_intersection(l0, l1);
+            return HalfPlaneRegion<Context>(ctx, bd1).contains_intersection(l0, l1);
         }
 
         Polygons intersection(const Polygon &poly) const;
+        Polygons intersection(const Polygons &polys) const;
+        // Same as in HalfPlaneRegion
+        void intersection(const Polygon &poly, Polygons &out) const;
+        void intersection(const Polygons &polys, Polygons &out) const;
 
     private:
         enum BoundaryType {kH0, kH1};
@@ -114,24 +126,72 @@ class UnionOfTwoHalfPlanesRegion : public Region {
         void link_polylines(
                 Polyline *polylines,
                 std::size_t num_polylines) const;
-        Polygons make_polygons(
+        void make_polygons(
                 const Polygon &poly,
                 Polyline *polylines,
-                std::size_t num_polylines) const;
+                std::size_t num_polylines,
+                Polygons &out) const;
 
         // used to compare two 
         bool comp_line_out_bd0(LineId id0, LineId id1) const {
-            return HalfPlaneRegion(ctx, id0).contains_intersection(bd0, id1);
+            return HalfPlaneRegion<Context>(ctx, id0).contains_intersection(bd0, id1);
         }
         bool comp_line_out_bd1(LineId id0, LineId id1) const {
-            return HalfPlaneRegion(ctx, id0).contains_intersection(bd1, id1);
+            return HalfPlaneRegion<Context>(ctx, id0).contains_intersection(bd1, id1);
+        }
+};
+
+// A sequence of regions to clip with, each a HalfPlaneRegion or
+// a UnionOfTwoHalfPlanesRegion. The clips are run one after another
+// through two shared buffers, and stop once nothing is left.
+template <class Context>
+class RegionSequence {
+    public:
+        const Context &ctx;
+
+        RegionSequence() = delete;
+        RegionSequence &operator=(const RegionSequence &other) = delete;
+
+        RegionSequence(const Context &ctx) : ctx(ctx) {}
+
+        void add_half_plane(LineId boundary_id) {
+            steps.push_back({false, boundary_id, boundary_id});
         }
+        void add_union(LineId bd0, LineId bd1) {
+            steps.push_back({true, bd0, bd1});
+        }
+        std::size_t size() const {return steps.size();}
+
+        Polygons intersection(const Polygons &polys) const;
+        // Clips polys into out, which is cleared first
+        void intersection(const Polygons &polys, Polygons &out) const;
+
+    private:
+        struct Step {
+            bool is_union;
+            LineId bd0, bd1;
+        };
+        std::vector<Step> steps;
 };
 
+extern template class HalfPlaneRegion<VanillaLineContext>;
+extern template class UnionOfTwoHalfPlanesRegion<VanillaLineContext>;
+extern template class RegionSequence<VanillaLineContext>;
+
 // what to do when connecting?
 // read next polyline
 //
 
+}; // namespace geometry
+
+namespace sofa {
+class SofaLineContext;
+}; // namespace sofa
+
+namespace geometry {
+extern template class HalfPlaneRegion<sofa::SofaLineContext>;
+extern template class UnionOfTwoHalfPlanesRegion<sofa::SofaLineContext>;
+extern template class RegionSequence<sofa::SofaLineContext>;
 }; // namespace geometry
 }; // namespace sofa_designer
 
@@ -0,0 +1,500 @@
+#include "search.hpp"
+
+#include "frontier.hpp"
+#include "progress.hpp"
+#include "sofa_pool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <tuple>
+#include <utility>
+
+#include <gmpxx.h>
+
+namespace sofa_designer {
+namespace search {
+
+using namespace sofa_designer::sofa;
+
+static Sofa *new_child(const Sofa &s, std::size_t idx, HalveType t)
+{
+    SOFA_PROFILE_SCOPE(kSofaChild);
+    return new Sofa(s, idx, t);
+}
+
+// the same for a worker, which recycles its sofas in a pool
+static Sofa *new_child(
+        SofaPool &pool, const Sofa &s, std::size_t idx, HalveType t)
+{
+    SOFA_PROFILE_SCOPE(kSofaChild);
+    return pool.child(s, idx, t);
+}
+
+static void free_sofa(SofaPool &pool, Sofa *s)
+{
+    SOFA_PROFILE_SCOPE(kSofaFree);
+    pool.recycle(s);
+}
+
+// the gain of s by (idx, t), computed on s itself, since an inherited 
+// gain may be wrong if a cut slipped past the test of inherit_gains
+static mpq_class own_gain(Sofa *s, std::size_t idx, HalveType t)
+{
+    if (s->gains[4*idx + t].inherited)
+        return s->calc_halve_gain(idx, t);
+    return s->halve_gain(idx, t);
+}
+
+std::tuple<Sofa*, Sofa*> branch(
+        Sofa *s,
+        const BranchChoice &choice)
+{
+    std::size_t idx = choice.idx;
+    Sofa *sd = new_child(*s, idx, choice.down());
+    Sofa *su = new_child(*s, idx, choice.up());
+    assert(sd->area() + own_gain(s, idx, choice.down()) == s->area());
+    assert(su->area() + own_gain(s, idx, choice.up()) == s->area());
+    return std::make_tuple(sd, su);
+}
+
+std::tuple<Sofa*, Sofa*> branch(
+        Sofa *s,
+        const BranchingPolicy &policy,
+        BranchChoice &choice)
+{
+    SOFA_PROFILE_SCOPE(kBranch);
+    choice = policy.choose(*s);
+    return branch(s, choice);
+}
+
+// the choice of branch(s, policy, choice), without the children
+static BranchChoice choose(Sofa *s, const BranchingPolicy &policy)
+{
+    SOFA_PROFILE_SCOPE(kBranch);
+    return policy.choose(*s);
+}
+
+std::tuple<Sofa*, Sofa*> branch(
+        Sofa *s, 
+        std::size_t mu_fix_idx,
+        const BranchConfig &config)
+{
+    assert(mu_fix_idx == s->mu_fix_idx);
+    BranchChoice choice;
+    return branch(s, GreedyPolicy(config), choice);
+}
+
+static void merge_hists(
+        std::vector< std::vector<unsigned long long> > &hists,
+        const std::vector< std::vector<unsigned long long> > &other)
+{
+    if (hists.size() < other.size())
+        hists.resize(other.size());
+    for (std::size_t r = 0; r < other.size(); r++) {
+        auto &h = hists[r];
+        const auto &oh = other[r];
+        if (h.size() < oh.size())
+            h.resize(oh.size());
+        for (std::size_t i = 0; i < oh.size(); i++)
+            h[i] += oh[i];
+    }
+}
+
+void SearchStats::merge(const SearchStats &other)
+{
+    num_iter += other.num_iter;
+    num_batches += other.num_batches;
+    for (auto h : {
+            std::make_pair(&branched_depths, &other.branched_depths),
+            std::make_pair(&closed_depths, &other.closed_depths)}) {
+        if (h.first->size() < h.second->size())
+            h.first->resize(h.second->size());
+        for (std::size_t i = 0; i < h.second->size(); i++)
+            (*h.first)[i] += (*h.second)[i];
+    }
+    merge_hists(root_closed_depths, other.root_closed_depths);
+    merge_hists(choice_depths, other.choice_depths);
+    closed_sofas.insert(closed_sofas.end(), 
+            other.closed_sofas.begin(), other.closed_sofas.end());
+    search_time += other.search_time;
+    redistribute_time += other.redistribute_time;
+    num_spilled += other.num_spilled;
+    num_restored += other.num_restored;
+    profile.merge(other.profile);
+    aborted = aborted || other.aborted;
+    spill_failed = spill_failed || other.spill_failed;
+}
+
+// sum of hist[d] * 2^-d
+static mpq_class dyadic_sum(const std::vector<unsigned long long> &hist)
+{
+    mpz_class num = 0;
+    for (std::size_t d = 0; d < hist.size(); d++)
+        num += mpz_class((unsigned long)hist[d]) << (hist.size() - 1 - d);
+    mpq_class res(num);
+    if (hist.size())
+        res /= mpz_class(1) << (hist.size() - 1);
+    return res;
+}
+
+mpq_class SearchStats::root_closed_volume(std::size_t root_idx) const
+{
+    if (root_idx >= root_closed_depths.size())
+        return 0;
+    return dyadic_sum(root_closed_depths[root_idx]);
+}
+
+mpq_class SearchStats::closed_volume(std::size_t num_roots) const
+{
+    mpq_class res = 0;
+    for (std::size_t r = 0; r < root_closed_depths.size(); r++)
+        res += root_closed_volume(r);
+    return res / num_roots;
+}
+
+static void count_depth(
+        std::vector<unsigned long long> &hist, 
+        std::size_t depth)
+{
+    if (hist.size() <= depth)
+        hist.resize(depth + 1);
+    hist[depth]++;
+}
+
+// An open sofa on the stack of a worker, or a child of one that is 
+// built only once popped. A child is left unbuilt when a gain its parent 
+// computed itself already tells that its area is not below the target,
+// which is checked again on the built child once popped.
+struct StackNode {
+    Sofa *sofa;
+    // the parent and halving of an unbuilt child
+    std::shared_ptr<Sofa> parent;
+    std::size_t idx;
+    HalveType t;
+    double area_estimate;
+
+    StackNode(Sofa *s) : 
+        sofa(s), idx(0), t(kMuDown), area_estimate(s->area_estimate) {}
+    StackNode(std::shared_ptr<Sofa> parent, std::size_t idx, HalveType t, 
+            double area_estimate) : 
+        sofa(nullptr), parent(parent), idx(idx), t(t), 
+        area_estimate(area_estimate) {}
+
+    // the sofa, built if not yet
+    Sofa *build(SofaPool &pool)
+    {
+        if (!sofa) {
+            sofa = new_child(pool, *parent, idx, t);
+            parent.reset();
+        }
+        return sofa;
+    }
+};
+
+// Publishes the progress since the last call to the metrics of a worker
+static void publish(
+        WorkerMetrics &metrics,
+        const std::vector<StackNode> &sofas,
+        unsigned long long &num_iter,
+        unsigned long long &num_closed,
+        std::vector<double> &closed_volume)
+{
+    const auto relaxed = std::memory_order_relaxed;
+    WorkerMetrics::add(metrics.num_iter, num_iter);
+    WorkerMetrics::add(metrics.num_closed, num_closed);
+    for (std::size_t r = 0; r < closed_volume.size(); r++) {
+        WorkerMetrics::add(metrics.root_closed_volume[r], closed_volume[r]);
+        closed_volume[r] = 0;
+    }
+    num_iter = num_closed = 0;
+
+    if (sofas.size()) {
+        double lo = sofas[0].area_estimate, hi = lo;
+        for (const StackNode &s : sofas) {
+            double a = s.area_estimate;
+            lo = std::min(lo, a);
+            hi = std::max(hi, a);
+        }
+        metrics.min_area.store(lo, relaxed);
+        metrics.max_area.store(hi, relaxed);
+    }
+    metrics.stack_size.store(sofas.size(), relaxed);
+}
+
+// loop for sofa thread
+// gets the list of pointers to sofas to divide
+// returns the sofas undone and the stats of iterations
+static std::tuple< std::vector<Sofa*>, SearchStats > sofa_thread(
+        std::vector<Sofa*> sofas, 
+        mpq_class target, 
+        const SearchConfig &config,
+        const BranchingPolicy *policy,
+        std::size_t num_iter,
+        std::chrono::steady_clock::time_point deadline,
+        WorkerMetrics *metrics)
+{
+    const std::size_t num_roots = config.num_roots;
+    SearchStats stats;
+    profile::thread_counters().clear();
+    unsigned long long iter_cnt = 0;
+    // not yet published to metrics
+    unsigned long long new_iter = 0, new_closed = 0;
+    std::vector<double> new_volume(num_roots, 0);
+    stats.root_closed_depths.resize(num_roots);
+    // declared before the stack, whose nodes may hold sofas to recycle
+    SofaPool pool;
+    auto count_closed = [&](std::size_t depth, std::size_t root_idx) {
+        count_depth(stats.closed_depths, depth);
+        count_depth(stats.root_closed_depths[root_idx], depth);
+        new_closed++;
+        new_volume[root_idx] += std::ldexp(1.0, -int(depth));
+    };
+    auto close = [&](Sofa *s) {
+        count_closed(s->depth, s->root_idx);
+        if (config.keep_closed)
+            stats.closed_sofas.push_back(s->record());
+        free_sofa(pool, s);
+    };
+    // A child closed without being built, from the exact gain 
+    // of its parent p
+    auto close_unbuilt = [&](Sofa &p, std::size_t idx, HalveType t) {
+        // an inherited gain is no proof, so such a child is built instead
+        const HalveGainCache &g = p.gains[4*idx + t];
+        assert(g.computed());
+        count_closed(p.depth + 1, p.root_idx);
+        if (config.keep_closed)
+            stats.closed_sofas.push_back({p.child_params(idx, t), 
+                    p.depth + 1, p.root_idx, p.area() - g.exact});
+    };
+    auto count_choice = [&](std::size_t depth, const BranchChoice &choice) {
+        count_depth(stats.branched_depths, depth);
+        if (stats.choice_depths.size() <= depth)
+            stats.choice_depths.resize(depth + 1);
+        count_depth(stats.choice_depths[depth], choice.code());
+    };
+    std::vector<StackNode> stack(sofas.begin(), sofas.end());
+    while (stack.size() && iter_cnt < num_iter) {
+        if (config.time_limit > 0 && 
+                std::chrono::steady_clock::now() >= deadline)
+            break;
+        Sofa *s = stack.rbegin()->build(pool);
+        stack.pop_back();
+        if (s->area_below(target)) {
+            close(s);
+        } else {
+            std::size_t levels = 
+                (s->depth >= config.split_min_depth ? config.split_levels : 1);
+            std::vector<Sofa*> pieces = {s};
+            for (std::size_t l = 0; l < levels && pieces.size(); l++) {
+                bool last = (l + 1 == levels);
+                // one choice for all pieces, made on the largest
+                std::size_t largest = 0;
+                for (std::size_t i = 1; i < pieces.size(); i++)
+                    if (pieces[largest]->area() < pieces[i]->area())
+                        largest = i;
+                BranchChoice choice = choose(pieces[largest], *policy);
+                std::vector<Sofa*> halves;
+                for (std::size_t i = 0; i < pieces.size(); i++) {
+                    count_choice(pieces[i]->depth, choice);
+                    std::shared_ptr<Sofa> p(pieces[i], [&](Sofa *ps) {
+                            free_sofa(pool, ps);
+                            });
+                    for (HalveType t : {choice.down(), choice.up()}) {
+                        // decided without building the child only from 
+                        // a gain that p computed, not one it inherited
+                        double est, err;
+                        int side = 0;
+                        if (p->estimate_child_area(choice.idx, t, est, err))
+                            side = Sofa::compare_estimate(est, err, target);
+                        if (side < 0) {
+                            close_unbuilt(*p, choice.idx, t);
+                        } else if (side > 0 && last) {
+                            stack.emplace_back(p, choice.idx, t, est);
+                        } else {
+                            Sofa *cs = new_child(pool, *p, choice.idx, t);
+                            if (cs->area_below(target))
+                                close(cs);
+                            else if (last)
+                                stack.emplace_back(cs);
+                            else
+                                halves.push_back(cs);
+                        }
+                    }
+                }
+                pieces = std::move(halves);
+            }
+        }
+        iter_cnt++;
+        new_iter++;
+        if (metrics && iter_cnt % 256U == 0)
+            publish(*metrics, stack, new_iter, new_closed, new_volume);
+    }
+    if (metrics)
+        publish(*metrics, stack, new_iter, new_closed, new_volume);
+    // the sofas left are handed back built
+    sofas.clear();
+    for (StackNode &node : stack)
+        sofas.push_back(node.build(pool));
+    stats.num_iter = iter_cnt;
+    if (profile::kEnabled)
+        stats.profile = profile::thread_counters();
+    return std::make_tuple(std::move(sofas), std::move(stats));
+}
+
+std::vector<Sofa*> run_search(
+        std::vector<Sofa*> sofas,
+        const mpq_class &target,
+        std::size_t mu_fix_idx,
+        const SearchConfig &config,
+        SearchStats &stats)
+{
+    typedef std::chrono::steady_clock Clock;
+    const std::size_t num_threads = config.num_threads;
+
+    // Run each batch through threads
+    unsigned long long budget_left = config.node_budget;
+    auto start_time = Clock::now(), last_profile_time = start_time;
+    auto deadline = start_time + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(config.time_limit));
+    std::unique_ptr<ProgressReporter> reporter;
+    if (config.print_progress)
+        reporter.reset(new ProgressReporter(
+                    num_threads, config.num_roots, 
+                    config.report_interval, std::cout));
+    assert(config.split_levels >= 1);
+    for (const Sofa *s : sofas) {
+        assert(s->root_idx < config.num_roots);
+        assert(s->mu_fix_idx == mu_fix_idx);
+    }
+    std::shared_ptr<const BranchingPolicy> policy = config.policy;
+    if (!policy)
+        policy = std::make_shared<GreedyPolicy>(config.branch);
+
+    // open sofas between batches, if they may not fit in memory
+    std::unique_ptr<Frontier> frontier;
+    if (config.max_in_memory && sofas.size()) {
+        frontier.reset(new Frontier(sofas[0]->mu, mu_fix_idx, 
+                    config.max_in_memory, config.spill_dir));
+        frontier->push(sofas);
+        sofas.clear();
+    }
+
+    // volume closed by earlier searches merged into stats
+    mpq_class start_volume = stats.closed_volume(config.num_roots);
+    while (sofas.size() || (frontier && !frontier->empty())) {
+        if (frontier && frontier->failed)
+            break;
+        if (config.node_budget && !budget_left)
+            break;
+        if (config.time_limit > 0 && std::chrono::duration<double>(
+                    Clock::now() - start_time).count() >= config.time_limit)
+            break;
+        if (config.abort_eta > 0) {
+            double elapsed = std::chrono::duration<double>(
+                    Clock::now() - start_time).count();
+            double volume = mpq_class(
+                    stats.closed_volume(config.num_roots) - start_volume).get_d();
+            double left = 1 - start_volume.get_d() - volume;
+            if (elapsed >= config.abort_after && 
+                    (volume <= 0 || left * elapsed / volume > config.abort_eta)) {
+                stats.aborted = true;
+                break;
+            }
+        }
+        // split the remaining budget evenly so that 
+        // the sofas visited do not depend on timing
+        std::vector<std::size_t> num_iter(num_threads, config.num_iter_per_batch);
+        if (config.node_budget) {
+            for (std::size_t i = 0; i < num_threads; i++) {
+                unsigned long long share = budget_left / num_threads + 
+                    (i < budget_left % num_threads ? 1 : 0);
+                if (share < num_iter[i])
+                    num_iter[i] = share;
+            }
+        }
+
+        stats.num_batches++;
+        if (config.print_progress) {
+            std::ostringstream line;
+            line << "Batch #" << stats.num_batches;
+            line << " Total iteration: " << stats.num_iter << "\n";
+            reporter->write(line.str());
+        }
+
+        // distribute the sofas to task_sofas
+        unsigned long long iter_before = stats.num_iter;
+        auto t0 = Clock::now();
+        if (frontier)
+            sofas = frontier->pop(std::max<std::size_t>(config.max_in_memory / 2, 1));
+        std::vector< std::vector<Sofa*> > task_sofas(num_threads);
+        for (std::size_t i = 0; i < sofas.size(); i++)
+            task_sofas[i % num_threads].push_back(sofas[i]);
+        sofas.clear();
+
+        // send divided task_sofas to workers
+        auto t1 = Clock::now();
+        std::vector< std::future< std::tuple< std::vector<Sofa*>, SearchStats > > >
+            done_sofas(num_threads);
+        for (std::size_t i = 0; i < num_threads; i++)
+            done_sofas[i] = std::async(std::launch::async, sofa_thread, 
+                    std::move(task_sofas[i]), 
+                    target, 
+                    std::cref(config),
+                    policy.get(),
+                    num_iter[i],
+                    deadline,
+                    reporter ? &reporter->worker(i) : nullptr);
+
+        // gather sofas back to list
+        std::vector< std::vector<Sofa*> > done(num_threads);
+        for (std::size_t i = 0; i < num_threads; i++) {
+            SearchStats thread_stats;
+            std::tie(done[i], thread_stats) = done_sofas[i].get();
+            stats.merge(thread_stats);
+        }
+        auto t2 = Clock::now();
+        for (std::size_t i = 0; i < num_threads; i++)
+            sofas.insert(sofas.end(), done[i].begin(), done[i].end());
+        if (frontier) {
+            frontier->push(sofas);
+            sofas.clear();
+        }
+        auto t3 = Clock::now();
+
+        if (config.node_budget) {
+            unsigned long long used = stats.num_iter - iter_before;
+            budget_left = (used < budget_left ? budget_left - used : 0);
+        }
+        stats.search_time += 
+            std::chrono::duration<double>(t2 - t1).count();
+        stats.redistribute_time += 
+            std::chrono::duration<double>((t1 - t0) + (t3 - t2)).count();
+
+        if (profile::kEnabled && config.profile_interval > 0 && 
+                std::chrono::duration<double>(t3 - last_profile_time).count() >= 
+                config.profile_interval) {
+            last_profile_time = t3;
+            profile::print_json(std::cerr, stats.profile, 
+                    std::chrono::duration<double>(t3 - start_time).count(),
+                    stats.num_iter);
+        }
+    }
+
+    if (frontier) {
+        sofas = frontier->pop(frontier->size());
+        stats.num_spilled += frontier->num_spilled;
+        stats.num_restored += frontier->num_restored;
+        stats.spill_failed = stats.spill_failed || frontier->failed;
+    }
+    return sofas;
+}
+
+}; // namespace search
+}; // namespace sofa_designer
@@ -0,0 +1,167 @@
+#ifndef SEARCH_HPP
+#define SEARCH_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <gmpxx.h>
+
+#include "policy.hpp"
+#include "profile.hpp"
+#include "sofa.hpp"
+
+namespace sofa_designer {
+namespace search {
+
+using sofa::Sofa;
+
+struct SearchConfig {
+    // Number of workers
+    std::size_t num_threads;
+    // How to branch; GreedyPolicy(branch) if policy is null
+    BranchConfig branch;
+    std::shared_ptr<const BranchingPolicy> policy;
+    // At depths from split_min_depth on, a sofa is halved 
+    // split_levels times in one iteration, into up to 2^split_levels 
+    // pieces. At each level the policy chooses on the largest piece, 
+    // so levels may halve different intervals, and the other pieces 
+    // of the level are halved along the same interval.
+    // A piece with area below the target is not halved further.
+    std::size_t split_levels;
+    std::size_t split_min_depth;
+    // Each worker does iteration up to this number 
+    // then redistributes all sofas to workers
+    std::size_t num_iter_per_batch;
+    // Stop after this many iterations in total; 0 for no limit
+    unsigned long long node_budget;
+    // Stop after this many seconds, which workers check 
+    // before every iteration; 0 for no limit
+    double time_limit;
+    // Print batches and progress lines to std::cout
+    bool print_progress;
+    // Seconds between progress lines; 0 for none
+    double report_interval;
+    // Number of equal parts the parameter space was split into
+    // for the initial sofas, for measuring the closed volume
+    std::size_t num_roots;
+    // Stop when, after abort_after seconds, the time left estimated 
+    // from the closed volume exceeds abort_eta seconds; 0 for never
+    double abort_eta, abort_after;
+    // With profiling compiled in, seconds between the JSON lines 
+    // of profile counters written to std::cerr; 0 for none
+    double profile_interval;
+    // Keep a SofaRecord of every closed sofa in SearchStats
+    bool keep_closed;
+    // Between batches, keep at most this many open sofas in memory
+    // and spill the ones of smallest area to run files in spill_dir
+    // (see Frontier); each batch then takes the max_in_memory / 2 
+    // sofas of largest area. 0 keeps every open sofa in memory.
+    std::size_t max_in_memory;
+    std::string spill_dir;
+
+    SearchConfig() :
+        num_threads(30),
+        split_levels(1),
+        split_min_depth(0),
+        num_iter_per_batch(10000),
+        node_budget(0),
+        time_limit(0),
+        print_progress(true),
+        report_interval(10),
+        num_roots(1),
+        abort_eta(0),
+        abort_after(60),
+        profile_interval(60),
+        keep_closed(false),
+        max_in_memory(0)
+    {
+    }
+};
+
+struct SearchStats {
+    // Iterations are sofas popped from the stack of a worker
+    unsigned long long num_iter;
+    unsigned long long num_batches;
+    // Histograms indexed by Sofa::depth
+    // of the sofas branched and of those closed by the target
+    std::vector<unsigned long long> branched_depths;
+    std::vector<unsigned long long> closed_depths;
+    // closed_depths split by Sofa::root_idx
+    std::vector< std::vector<unsigned long long> > root_closed_depths;
+    // Number of times each choice was made at each depth,
+    // as choice_depths[depth][BranchChoice::code()]
+    std::vector< std::vector<unsigned long long> > choice_depths;
+    // Wall-clock seconds spent running the workers 
+    // and redistributing sofas between batches
+    double search_time, redistribute_time;
+    // The closed sofas, if SearchConfig::keep_closed
+    std::vector<sofa::SofaRecord> closed_sofas;
+    // Open sofas written to run files and read back,
+    // with SearchConfig::max_in_memory
+    unsigned long long num_spilled, num_restored;
+    // Filled only when profiling is compiled in
+    profile::Counters profile;
+    // Whether the search stopped on abort_eta
+    bool aborted;
+    // Whether the search stopped on a failed run file of 
+    // SearchConfig::max_in_memory, which may have lost open sofas
+    bool spill_failed;
+
+    SearchStats() :
+        num_iter(0), num_batches(0), 
+        search_time(0), redistribute_time(0),
+        num_spilled(0), num_restored(0),
+        aborted(false),
+        spill_failed(false)
+    {
+    }
+
+    void merge(const SearchStats &other);
+
+    // Fraction of the box of the initial sofa `root_idx` covered 
+    // by the boxes of closed sofas. Each halving halves the box, 
+    // so a sofa of depth d covers 2^-d of its root.
+    mpq_class root_closed_volume(std::size_t root_idx) const;
+    // Same for the whole parameter space split into num_roots roots
+    mpq_class closed_volume(std::size_t num_roots) const;
+};
+
+// Halves `s` by `choice` and returns the two resulting children, 
+// lower half first
+std::tuple<Sofa*, Sofa*> branch(
+        Sofa *s,
+        const BranchChoice &choice);
+
+// Same along the choice of `policy`, which is stored to `choice`
+std::tuple<Sofa*, Sofa*> branch(
+        Sofa *s,
+        const BranchingPolicy &policy,
+        BranchChoice &choice);
+
+// Splits `s` along the (idx, HalveType) pair with maximum halve_gain
+// (up to the screening of BranchConfig), as GreedyPolicy
+std::tuple<Sofa*, Sofa*> branch(
+        Sofa *s, 
+        std::size_t mu_fix_idx,
+        const BranchConfig &config = BranchConfig());
+
+// Branches the given sofas in batches until every sofa has 
+// area below `target`, the node budget or time limit is exhausted,
+// the search is aborted by config.abort_eta or a run file fails.
+// Every root_idx should be less than config.num_roots.
+// Takes ownership of `sofas` and returns the ones still open,
+// largest first if config.max_in_memory is set.
+std::vector<Sofa*> run_search(
+        std::vector<Sofa*> sofas,
+        const mpq_class &target,
+        std::size_t mu_fix_idx,
+        const SearchConfig &config,
+        SearchStats &stats);
+
+}; // namespace search
+}; // namespace sofa_designer
+
+#endif // SEARCH_HPP
@@ -0,0 +1,165 @@
+#ifndef SHARED_TABLE_HPP
+#define SHARED_TABLE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace sofa_designer {
+
+struct SharedTableStats {
+    // lookups answered by an entry, and entries made
+    unsigned long long num_hits, num_misses;
+    // entries kept, including those not swept yet
+    std::size_t num_entries;
+};
+
+// Value of the tables that only intern() keys
+struct NoValue {};
+
+// Immutable values shared by all threads, each made once per key
+// and handed out as shared_ptr's. The table is split in shards
+// locked separately. An entry no handle refers to any more is
+// dropped by the next sweep of its shard, which happens whenever
+// the shard has grown by half since the last one. Until then, 
+// the dropped entries are a cache of values made again soon.
+// Sweeping at twice the size makes 40% fewer intersections, 
+// but the search then takes more memory than without the store.
+//
+// Hash maps a Key to std::size_t, and keys are compared with ==.
+template <class Key, class Value, class Hash>
+class SharedTable {
+    public:
+        typedef SharedTableStats Stats;
+
+        SharedTable()
+        {
+            for (auto &s : shards) {
+                s.sweep_at = kMinSweep;
+                s.num_hits = s.num_misses = 0;
+            }
+        }
+        SharedTable(const SharedTable &other) = delete;
+        SharedTable &operator=(const SharedTable &other) = delete;
+
+        // The value of key, made by make() when no entry has it.
+        // make() is called without holding a lock.
+        // Sets *hit to whether an entry had it.
+        template <class Make>
+        std::shared_ptr<const Value> get(
+                const Key &key, Make make, bool *hit = nullptr)
+        {
+            std::shared_ptr<const Entry> e = get_entry(key, make, hit);
+            return std::shared_ptr<const Value>(e, &e->value);
+        }
+        // The canonical copy of key itself
+        std::shared_ptr<const Key> intern(const Key &key, bool *hit = nullptr)
+        {
+            std::shared_ptr<const Entry> e = get_entry(
+                    key, []{return Value();}, hit);
+            return std::shared_ptr<const Key>(e, &e->key);
+        }
+
+        Stats stats() const
+        {
+            Stats res = {0, 0, 0};
+            for (const auto &s : shards) {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                res.num_hits += s.num_hits;
+                res.num_misses += s.num_misses;
+                res.num_entries += s.map.size();
+            }
+            return res;
+        }
+
+    private:
+        struct Entry {
+            Key key;
+            Value value;
+        };
+        // keyed by the hash of the key
+        typedef std::unordered_multimap<
+            std::size_t, std::shared_ptr<const Entry> > Map;
+
+        struct Shard {
+            mutable std::mutex mutex;
+            Map map;
+            std::size_t sweep_at;
+            unsigned long long num_hits, num_misses;
+        };
+
+        static const std::size_t kNumShards = 64;
+        // dropped entries are kept up to this many per shard
+        static const std::size_t kMinSweep = 64;
+        Shard shards[kNumShards];
+
+        template <class Make>
+        std::shared_ptr<const Entry> get_entry(
+                const Key &key, Make make, bool *hit)
+        {
+            std::size_t h = Hash()(key);
+            Shard &s = shards[(h >> 7) % kNumShards];
+            {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                std::shared_ptr<const Entry> e = find(s, h, key);
+                if (e) {
+                    s.num_hits++;
+                    if (hit)
+                        *hit = true;
+                    return e;
+                }
+            }
+
+            std::shared_ptr<const Entry> made =
+                std::make_shared<const Entry>(Entry{key, make()});
+
+            std::lock_guard<std::mutex> lock(s.mutex);
+            // another thread may have added it in the meantime
+            std::shared_ptr<const Entry> e = find(s, h, key);
+            if (e) {
+                s.num_hits++;
+                if (hit)
+                    *hit = true;
+                return e;
+            }
+            s.num_misses++;
+            if (hit)
+                *hit = false;
+            s.map.emplace(h, made);
+            if (s.map.size() >= s.sweep_at)
+                sweep(s);
+            return made;
+        }
+
+        // the entry of key in s, which should be locked
+        static std::shared_ptr<const Entry> find(
+                const Shard &s, std::size_t h, const Key &key)
+        {
+            auto range = s.map.equal_range(h);
+            for (auto it = range.first; it != range.second; ++it)
+                if (it->second->key == key)
+                    return it->second;
+            return nullptr;
+        }
+
+        static void sweep(Shard &s)
+        {
+            // only the table holds such entries, and it is locked
+            for (auto it = s.map.begin(); it != s.map.end(); ) {
+                if (it->second.use_count() == 1)
+                    it = s.map.erase(it);
+                else
+                    ++it;
+            }
+            s.sweep_at = std::max(kMinSweep, 3 * s.map.size() / 2);
+        }
+};
+
+template <class Key, class Value, class Hash>
+const std::size_t SharedTable<Key, Value, Hash>::kMinSweep;
+
+}; // namespace sofa_designer
+
+#endif // SHARED_TABLE_HPP
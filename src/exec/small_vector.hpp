@@ -0,0 +1,257 @@
+#ifndef SMALL_VECTOR_HPP
+#define SMALL_VECTOR_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace sofa_designer {
+
+// A vector holding up to N elements in itself, and on the heap
+// only when it grows larger. The interface is the part of std::vector
+// used in this project; iterators are plain pointers.
+// As with std::vector, any insertion may invalidate them.
+template <class T, std::size_t N>
+class SmallVector {
+    public:
+        typedef T value_type;
+        typedef std::size_t size_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef T &reference;
+        typedef const T &const_reference;
+        typedef T *pointer;
+        typedef const T *const_pointer;
+        typedef T *iterator;
+        typedef const T *const_iterator;
+        typedef std::reverse_iterator<iterator> reverse_iterator;
+        typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+        SmallVector() : ptr(inline_data()), len(0), cap(N) {}
+        explicit SmallVector(size_type n) : SmallVector()
+        {
+            resize(n);
+        }
+        SmallVector(size_type n, const T &value) : SmallVector()
+        {
+            reserve(n);
+            for (size_type i = 0; i < n; i++)
+                push_back(value);
+        }
+        SmallVector(std::initializer_list<T> init) : 
+            SmallVector(init.begin(), init.end()) {}
+        template <class It, class = typename std::enable_if<
+            !std::is_integral<It>::value>::type>
+        SmallVector(It first, It last) : SmallVector()
+        {
+            append(first, last);
+        }
+        SmallVector(const SmallVector &other) : 
+            SmallVector(other.begin(), other.end()) {}
+        SmallVector(SmallVector &&other) : SmallVector()
+        {
+            steal(other);
+        }
+        ~SmallVector()
+        {
+            clear();
+            release();
+        }
+
+        SmallVector &operator=(const SmallVector &other)
+        {
+            if (this != &other) {
+                clear();
+                append(other.begin(), other.end());
+            }
+            return *this;
+        }
+        SmallVector &operator=(SmallVector &&other)
+        {
+            if (this != &other) {
+                clear();
+                release();
+                ptr = inline_data();
+                cap = N;
+                steal(other);
+            }
+            return *this;
+        }
+        SmallVector &operator=(std::initializer_list<T> init)
+        {
+            clear();
+            append(init.begin(), init.end());
+            return *this;
+        }
+
+        iterator begin() {return ptr;}
+        iterator end() {return ptr + len;}
+        const_iterator begin() const {return ptr;}
+        const_iterator end() const {return ptr + len;}
+        const_iterator cbegin() const {return ptr;}
+        const_iterator cend() const {return ptr + len;}
+        reverse_iterator rbegin() {return reverse_iterator(end());}
+        reverse_iterator rend() {return reverse_iterator(begin());}
+        const_reverse_iterator rbegin() const {return const_reverse_iterator(end());}
+        const_reverse_iterator rend() const {return const_reverse_iterator(begin());}
+
+        size_type size() const {return len;}
+        size_type capacity() const {return cap;}
+        bool empty() const {return !len;}
+        // whether the elements are on the heap
+        bool is_spilled() const {return ptr != inline_data();}
+
+        T *data() {return ptr;}
+        const T *data() const {return ptr;}
+        T &operator[](size_type i) {return ptr[i];}
+        const T &operator[](size_type i) const {return ptr[i];}
+        T &front() {return ptr[0];}
+        const T &front() const {return ptr[0];}
+        T &back() {return ptr[len - 1];}
+        const T &back() const {return ptr[len - 1];}
+
+        void reserve(size_type n)
+        {
+            if (n <= cap)
+                return;
+            T *p = static_cast<T *>(::operator new(n * sizeof(T)));
+            for (size_type i = 0; i < len; i++) {
+                new (p + i) T(std::move(ptr[i]));
+                ptr[i].~T();
+            }
+            release();
+            ptr = p;
+            cap = n;
+        }
+        void resize(size_type n)
+        {
+            reserve(n);
+            while (len > n)
+                pop_back();
+            while (len < n)
+                emplace_back();
+        }
+        void clear()
+        {
+            for (size_type i = 0; i < len; i++)
+                ptr[i].~T();
+            len = 0;
+        }
+
+        void push_back(const T &value) {emplace_back(value);}
+        void push_back(T &&value) {emplace_back(std::move(value));}
+        template <class... Args>
+        void emplace_back(Args&&... args)
+        {
+            if (len == cap)
+                grow(len + 1);
+            new (ptr + len) T(std::forward<Args>(args)...);
+            len++;
+        }
+        void pop_back()
+        {
+            assert(len);
+            ptr[--len].~T();
+        }
+
+        template <class It>
+        iterator insert(const_iterator pos, It first, It last)
+        {
+            size_type at = pos - ptr, old_len = len;
+            append(first, last);
+            std::rotate(ptr + at, ptr + old_len, ptr + len);
+            return ptr + at;
+        }
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            iterator f = ptr + (first - ptr), l = ptr + (last - ptr);
+            iterator new_end = std::move(l, end(), f);
+            while (end() != new_end)
+                pop_back();
+            return f;
+        }
+
+        friend bool operator==(const SmallVector &a, const SmallVector &b)
+        {
+            return a.len == b.len && std::equal(a.begin(), a.end(), b.begin());
+        }
+        friend bool operator!=(const SmallVector &a, const SmallVector &b)
+        {
+            return !(a == b);
+        }
+        friend bool operator<(const SmallVector &a, const SmallVector &b)
+        {
+            return std::lexicographical_compare(
+                    a.begin(), a.end(), b.begin(), b.end());
+        }
+        friend bool operator>(const SmallVector &a, const SmallVector &b) {return b < a;}
+        friend bool operator<=(const SmallVector &a, const SmallVector &b) {return !(b < a);}
+        friend bool operator>=(const SmallVector &a, const SmallVector &b) {return !(a < b);}
+
+    private:
+        T *ptr;
+        size_type len, cap;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage[N];
+
+        T *inline_data() {return reinterpret_cast<T *>(storage);}
+        const T *inline_data() const {return reinterpret_cast<const T *>(storage);}
+
+        void grow(size_type n)
+        {
+            reserve(std::max(n, 2 * cap));
+        }
+        template <class It>
+        void append(It first, It last)
+        {
+            append(first, last, 
+                    typename std::iterator_traits<It>::iterator_category());
+        }
+        template <class It>
+        void append(It first, It last, std::input_iterator_tag)
+        {
+            for (; first != last; ++first)
+                emplace_back(*first);
+        }
+        // one reservation and a loop without checks
+        template <class It>
+        void append(It first, It last, std::forward_iterator_tag)
+        {
+            size_type n = std::distance(first, last);
+            if (len + n > cap)
+                grow(len + n);
+            for (T *p = ptr + len; first != last; ++first, ++p)
+                new (p) T(*first);
+            len += n;
+        }
+        // frees the heap block; the elements should be destroyed
+        void release()
+        {
+            if (is_spilled())
+                ::operator delete(ptr);
+        }
+        // takes the elements of other; this should be empty and inline
+        void steal(SmallVector &other)
+        {
+            if (other.is_spilled()) {
+                ptr = other.ptr;
+                len = other.len;
+                cap = other.cap;
+                other.ptr = other.inline_data();
+                other.len = 0;
+                other.cap = N;
+            } else {
+                for (size_type i = 0; i < other.len; i++)
+                    new (ptr + i) T(std::move(other.ptr[i]));
+                len = other.len;
+                other.clear();
+            }
+        }
+};
+
+}; // namespace sofa_designer
+
+#endif // SMALL_VECTOR_HPP
@@ -1,10 +1,18 @@
 #include "sofa.hpp"
 
+#include <cmath>
+
+#include "profile.hpp"
+
 namespace sofa_designer {
 namespace sofa {
 
 using sofa_designer::geometry::intersection;
 
+// mpq_class::get_d() truncates, so a rounded number is off by less 
+// than this relative to itself, and so is a double product or sum
+static const double kRoundingBound = std::ldexp(1.0, -52);
+
 SofaMetadata SofaMetadata::a_priori_sofa_metadata(
         std::vector<Coord> normals,
         std::size_t mu_fix_idx,
@@ -76,10 +84,107 @@ std::vector<Sofa*> Sofa::a_priori_sofas(
                 md.init_params[i].mu_range,
                 md.init_params[i].nu_range,
                 mu_fix_idx);
+        sofas[i]->root_idx = i;
     }
     return sofas;
 }
 
+static bool write_size(FILE *file, std::size_t v)
+{
+    unsigned long long x = v;
+    return std::fwrite(&x, sizeof(x), 1, file) == 1;
+}
+
+static bool read_size(FILE *file, std::size_t &v)
+{
+    unsigned long long x;
+    if (std::fread(&x, sizeof(x), 1, file) != 1)
+        return false;
+    v = x;
+    return true;
+}
+
+static bool write_mpq(FILE *file, const mpq_class &q)
+{
+    if (!mpz_out_raw(file, q.get_num_mpz_t()))
+        return false;
+    if (!mpz_out_raw(file, q.get_den_mpz_t()))
+        return false;
+    return true;
+}
+
+static bool read_mpq(FILE *file, mpq_class &q)
+{
+    if (!mpz_inp_raw(q.get_num_mpz_t(), file))
+        return false;
+    if (!mpz_inp_raw(q.get_den_mpz_t(), file))
+        return false;
+    return true;
+}
+
+bool SofaParams::write(FILE *file) const
+{
+    assert(mu_range.size() == nu_range.size());
+    if (!write_size(file, mu_range.size()))
+        return false;
+    for (const auto *range : {&mu_range, &nu_range}) {
+        for (const auto &r : *range) {
+            if (!write_mpq(file, r.min) || !write_mpq(file, r.max))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool SofaParams::read(FILE *file, SofaParams &p)
+{
+    std::size_t n;
+    if (!read_size(file, n))
+        return false;
+    p.mu_range.resize(n);
+    p.nu_range.resize(n);
+    for (auto *range : {&p.mu_range, &p.nu_range}) {
+        for (auto &r : *range) {
+            if (!read_mpq(file, r.min) || !read_mpq(file, r.max))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool SofaRecord::write(FILE *file) const
+{
+    return params.write(file) &&
+        write_size(file, depth) &&
+        write_size(file, root_idx) &&
+        write_mpq(file, area);
+}
+
+bool SofaRecord::read(FILE *file, SofaRecord &r)
+{
+    return SofaParams::read(file, r.params) &&
+        read_size(file, r.depth) &&
+        read_size(file, r.root_idx) &&
+        read_mpq(file, r.area);
+}
+
+SofaRecord Sofa::record() const
+{
+    return {{mu_range, nu_range}, depth, root_idx, area()};
+}
+
+Sofa *Sofa::from_record(
+        const std::vector<Coord> &normals,
+        std::size_t mu_fix_idx,
+        const SofaRecord &r)
+{
+    Sofa *s = new Sofa(normals, r.params.mu_range, r.params.nu_range, mu_fix_idx);
+    assert(s->area() == r.area);
+    s->depth = r.depth;
+    s->root_idx = r.root_idx;
+    return s;
+}
+
 std::vector<Coord> Sofa::mu_to_nu(
         std::vector<Coord> mu)
 {
@@ -144,7 +249,12 @@ Sofa::Sofa(
     nu_range(nu_range),
     ctx(make_band_pairs(mu, nu, mu_range, nu_range, mu_fix_idx)),
     polygons(),
-    area()
+    area_estimate(0),
+    area_error(0),
+    depth(0),
+    root_idx(0),
+    gains(4 * n),
+    area_known(false)
 {
     for (const auto &coord : normals) {
         assert(coord.x > 0);
@@ -154,20 +264,33 @@ Sofa::Sofa(
     Coord pivot = ctx.intersection(
             luu(mu_fix_idx), ruu(mu_fix_idx));
     assert(pivot.y > 0);
-    polygons = {{short(~luu(mu_fix_idx)), hl(), short(~ruu(mu_fix_idx))}};
-    polygons = HalfPlaneRegion(ctx, short(~hu())).intersection(polygons);
+    // the clipping order fixes where the vertex lists of the polygons 
+    // start, so it is kept as it was
+    RegionSequence<SofaLineContext> seq(ctx);
+    seq.add_half_plane(short(~hu()));
     for (std::size_t i = 0; i < n; i++) {
-        polygons = UnionOfTwoHalfPlanesRegion(
-                ctx, ldd(i), rdd(i)).intersection(polygons);
-        polygons = HalfPlaneRegion(ctx, short(~luu(i))).intersection(polygons);
-        polygons = HalfPlaneRegion(ctx, short(~ruu(i))).intersection(polygons);
+        seq.add_union(ldd(i), rdd(i));
+        seq.add_half_plane(short(~luu(i)));
+        seq.add_half_plane(short(~ruu(i)));
     }
+    seq.intersection(
+            {{short(~luu(mu_fix_idx)), hl(), short(~ruu(mu_fix_idx))}}, polygons);
 
-    area = calc_area(polygons);
+    set_area(calc_area(polygons));
 }
 
 
 
+// the context of a child, timed as a whole with the copy from the parent
+static SofaLineContext child_context(
+        const SofaLineContext &ctx,
+        SlopeId bs,
+        BranchDirection dir)
+{
+    SOFA_PROFILE_SCOPE(kContextBranch);
+    return SofaLineContext(ctx, bs, dir);
+}
+
 Sofa::Sofa(
         const Sofa &other, 
         std::size_t idx,
@@ -178,38 +301,69 @@ Sofa::Sofa(
     nu(other.nu),
     mu_range(other.mu_range), // to be updated
     nu_range(other.nu_range), // to be updated
-    ctx(other.ctx, (is_mu(t) ? idx : n + 1 + idx), halve_dir(t)),
-    polygons(other.polygons), // to be updated
-    area() // to be updated
+    ctx(child_context(other.ctx, (is_mu(t) ? idx : n + 1 + idx), halve_dir(t))),
+    polygons(), // to be updated
+    area_estimate(0), // to be updated
+    area_error(0), // to be updated
+    depth(other.depth + 1),
+    root_idx(other.root_idx),
+    gains(4 * n), // to be updated
+    area_known(false)
+{
+    halve_from(other, idx, t);
+}
+
+void Sofa::assign_child(
+        const Sofa &other,
+        std::size_t idx,
+        HalveType t)
+{
+    // assignments keep the storage of vectors and of the GMP numbers
+    n = other.n;
+    mu_fix_idx = other.mu_fix_idx;
+    mu = other.mu;
+    nu = other.nu;
+    mu_range = other.mu_range;
+    nu_range = other.nu_range;
+    {
+        SOFA_PROFILE_SCOPE(kContextBranch);
+        ctx.assign_child(other.ctx, 
+                (is_mu(t) ? idx : n + 1 + idx), halve_dir(t));
+    }
+    depth = other.depth + 1;
+    root_idx = other.root_idx;
+    gains.resize(4 * n);
+    for (auto &g : gains)
+        g.exact_known = g.approx_known = g.inherited = false;
+    area_known = false;
+    halve_from(other, idx, t);
+}
+
+void Sofa::halve_from(
+        const Sofa &other,
+        std::size_t idx,
+        HalveType t)
 {
     if (idx == mu_fix_idx) {
         assert(t != kMuDown && t != kMuUp);
     }
 
     // update mu_range and nu_range
-    if (t == kMuDown) {
-        mu_range[idx].max = mu_range[idx].avg();
-    } else if (t == kMuUp) {
-        mu_range[idx].min = mu_range[idx].avg();
-    } else if (t == kNuDown) {
-        nu_range[idx].max = nu_range[idx].avg();
-    } else if (t == kNuUp) {
-        nu_range[idx].min = nu_range[idx].avg();
-    }
+    halve_ranges(mu_range, nu_range, idx, t);
 
-    // update polygons
+    // update polygons, clipping the parent's into this
     if (t == kMuDown) {
-        polygons = HalfPlaneRegion(other.ctx, 
-                short(~rud(idx))).intersection(polygons);
+        HalfPlaneRegion<SofaLineContext>(other.ctx, 
+                short(~rud(idx))).intersection(other.polygons, polygons);
     } else if (t == kMuUp) {
-        polygons = UnionOfTwoHalfPlanesRegion(other.ctx,
-                ldd(idx), rdu(idx)).intersection(polygons);
+        UnionOfTwoHalfPlanesRegion<SofaLineContext>(other.ctx,
+                ldd(idx), rdu(idx)).intersection(other.polygons, polygons);
     } else if (t == kNuDown) {
-        polygons = HalfPlaneRegion(other.ctx,
-                short(~lud(idx))).intersection(polygons);
+        HalfPlaneRegion<SofaLineContext>(other.ctx,
+                short(~lud(idx))).intersection(other.polygons, polygons);
     } else if (t == kNuUp) {
-        polygons = UnionOfTwoHalfPlanesRegion(other.ctx,
-                ldu(idx), rdd(idx)).intersection(polygons);
+        UnionOfTwoHalfPlanesRegion<SofaLineContext>(other.ctx,
+                ldu(idx), rdd(idx)).intersection(other.polygons, polygons);
     }
     // convert back to this context
     for (auto &poly : polygons) {
@@ -227,35 +381,173 @@ Sofa::Sofa(
         }
     }
 
-    area = calc_area(polygons);
+    // the area is the one of the parent less the part cut off,
+    // if the parent has computed that part itself
+    const HalveGainCache &g = other.gains[4*idx + t];
+    if (g.computed() && other.area_known)
+        set_area(other.area_exact - g.exact);
+    else if (!other.estimate_child_area(idx, t, area_estimate, area_error))
+        vertex_area(area_estimate, area_error);
+    inherit_gains(other, idx, t);
 }
 
-mpq_class Sofa::halve_gain(
+void Sofa::halve_ranges(
+        std::vector<Interval> &mu_range,
+        std::vector<Interval> &nu_range,
         std::size_t idx,
         HalveType t)
 {
     if (t == kMuDown) {
-        return calc_area(
-                HalfPlaneRegion(ctx, rud(idx)).intersection(polygons)
-                );
+        mu_range[idx].max = mu_range[idx].avg();
     } else if (t == kMuUp) {
-        auto p = HalfPlaneRegion(ctx, short(~ldd(idx))).intersection(polygons);
-        p = HalfPlaneRegion(ctx, short(~rdu(idx))).intersection(p);
-        return calc_area(p);
+        mu_range[idx].min = mu_range[idx].avg();
     } else if (t == kNuDown) {
-        return calc_area(
-                HalfPlaneRegion(ctx, lud(idx)).intersection(polygons)
-                );
-    } else { // (t == kNuUp) 
-        auto p = HalfPlaneRegion(ctx, short(~rdd(idx))).intersection(polygons);
-        p = HalfPlaneRegion(ctx, short(~ldu(idx))).intersection(p);
-        return calc_area(p);
+        nu_range[idx].max = nu_range[idx].avg();
+    } else if (t == kNuUp) {
+        nu_range[idx].min = nu_range[idx].avg();
+    }
+}
+
+SofaParams Sofa::child_params(
+        std::size_t idx,
+        HalveType t) const
+{
+    SofaParams p = {mu_range, nu_range};
+    halve_ranges(p.mu_range, p.nu_range, idx, t);
+    return p;
+}
+
+std::vector<LineId> Sofa::halve_boundaries(
+        std::size_t idx,
+        HalveType t) const
+{
+    if (t == kMuDown)
+        return {rud(idx)};
+    else if (t == kMuUp)
+        return {short(~ldd(idx)), short(~rdu(idx))};
+    else if (t == kNuDown)
+        return {lud(idx)};
+    else // (t == kNuUp)
+        return {short(~rdd(idx)), short(~ldu(idx))};
+}
+
+mpq_class Sofa::halve_gain(
+        std::size_t idx,
+        HalveType t)
+{
+    HalveGainCache &g = gains[4*idx + t];
+    if (!g.exact_known) {
+        g.exact = calc_halve_gain(idx, t);
+        g.exact_known = true;
+    }
+    return g.exact;
+}
+
+mpq_class Sofa::calc_halve_gain(
+        std::size_t idx,
+        HalveType t)
+{
+    SOFA_PROFILE_SCOPE(kHalveGain);
+    // clip back and forth between two buffers
+    Polygons buf[2];
+    const Polygons *p = &polygons;
+    std::size_t i = 0;
+    for (LineId b : halve_boundaries(idx, t)) {
+        HalfPlaneRegion<SofaLineContext>(ctx, b).intersection(*p, buf[i]);
+        p = &buf[i];
+        i ^= 1;
+    }
+    return calc_area(*p);
+}
+
+// Part of polys in HalfPlaneRegion(ctx, boundary)
+static ApproxPolygons approx_clip(
+        const ApproxPolygons &polys,
+        const SofaLineContext &ctx,
+        LineId boundary)
+{
+    bool above = (boundary >= 0);
+    ApproxLine line(ctx.line(above ? boundary : ~boundary));
+    ApproxPolygons res;
+    res.reserve(polys.size());
+    for (const auto &p : polys)
+        res.push_back(geometry::approx_clip(p, line, above));
+    return res;
+}
+
+double Sofa::approx_halve_gain(
+        const ApproxPolygons &approx,
+        std::size_t idx,
+        HalveType t)
+{
+    HalveGainCache &g = gains[4*idx + t];
+    if (!g.approx_known) {
+        ApproxPolygons p = approx;
+        for (LineId b : halve_boundaries(idx, t))
+            p = approx_clip(p, ctx, b);
+        g.approx = approx_area(p);
+        g.approx_known = true;
+    }
+    return g.approx;
+}
+
+// The vertices of approx_polygons() are rounded from exact ones,
+// and clipping them adds a few more roundings, so they are normally 
+// off by far less than this. An edge nearly parallel to the clipping 
+// line can put a clipped vertex farther off, so this is no proven 
+// bound, and the gains kept with it are marked inherited.
+static const double kApproxMargin = 1e-9;
+
+void Sofa::inherit_gains(
+        const Sofa &parent,
+        std::size_t idx,
+        HalveType t)
+{
+    SOFA_PROFILE_SCOPE(kInheritGains);
+    bool any_known = false;
+    for (const auto &g : parent.gains)
+        any_known = any_known || g.exact_known || g.approx_known;
+    if (!any_known)
+        return;
+
+    // the part of the parent cut off by this halving
+    ApproxPolygons cut = parent.approx_polygons();
+    for (LineId b : parent.halve_boundaries(idx, t))
+        cut = approx_clip(cut, parent.ctx, b);
+
+    // A pair (j, u) with j != idx has the same lines in both contexts.
+    // If the cut part misses one of its half-planes, 
+    // the part it cuts off is the same for parent and child.
+    for (std::size_t j = 0; j < n; j++) {
+        if (j == idx)
+            continue;
+        for (auto u : {kMuDown, kMuUp, kNuDown, kNuUp}) {
+            const HalveGainCache &g = parent.gains[4*j + u];
+            if (!g.exact_known && !g.approx_known)
+                continue;
+            bool keep = false;
+            for (LineId b : halve_boundaries(j, u)) {
+                bool above = (b >= 0);
+                ApproxLine line(ctx.line(above ? b : ~b));
+                if (approx_misses(cut, line, above, kApproxMargin)) {
+                    keep = true;
+                    break;
+                }
+            }
+            if (keep) {
+                SOFA_PROFILE_COUNT(kGainKept);
+                gains[4*j + u] = g;
+                gains[4*j + u].inherited = g.exact_known;
+            } else {
+                SOFA_PROFILE_COUNT(kGainDropped);
+            }
+        }
     }
 }
 
 // LineId - Coord conversions
 
-std::vector<Coord> Sofa::poly_to_coord(Polygon p)
+std::vector<Coord> Sofa::poly_to_coord(const Polygon &p)
 {
     if (p.size() == 0)
         return {};
@@ -271,32 +563,143 @@ std::vector<Coord> Sofa::poly_to_coord(Polygon p)
     return coord_poly;
 }
 
-mpq_class Sofa::calc_area(Polygon p)
+mpq_class Sofa::calc_area(const Polygon &p) const
 {
-    std::vector<Coord> coord_p = poly_to_coord(p);
-    if (coord_p.size() == 0)
+    if (p.size() == 0)
         return 0_mpq;
 
+    // the vertices are read in place from the shared intersections
     mpq_class res = 0_mpq;
     std::size_t p_size = p.size();
-    std::size_t prev_idx = p_size - 1;
+    const Coord *c0 = &ctx.intersection_ref(p[p_size - 1], p[p_size - 2]);
     for (std::size_t i = 0; i < p_size; i++) {
-        Coord &c0 = coord_p[prev_idx];
-        Coord &c1 = coord_p[i];
-        prev_idx = i;
-        res += c0.x * c1.y - c0.y * c1.x;
+        const Coord &c1 = ctx.intersection_ref(p[i], p[(i + p_size - 1) % p_size]);
+        res += c0->x * c1.y - c0->y * c1.x;
+        c0 = &c1;
     }
     return res/2_mpz;
 }
 
-mpq_class Sofa::calc_area(Polygons p)
+mpq_class Sofa::calc_area(const Polygons &p) const
 {
+    SOFA_PROFILE_SCOPE(kCalcArea);
     mpq_class res = 0_mpq;
     for (auto &pp : p)
         res += calc_area(pp);
     return res;
 }
 
+// Area
+
+const mpq_class &Sofa::area() const
+{
+    if (!area_known) {
+        SOFA_PROFILE_COUNT(kAreaExact);
+        area_exact = calc_area(polygons);
+        area_known = true;
+    }
+    return area_exact;
+}
+
+bool Sofa::area_below(const mpq_class &target) const
+{
+    if (!area_known) {
+        int side = compare_estimate(area_estimate, area_error, target);
+        if (side)
+            return side < 0;
+    }
+    return area() < target;
+}
+
+int Sofa::compare_estimate(
+        double estimate, 
+        double error, 
+        const mpq_class &target)
+{
+    // the error of the rounded target, and of the sums below
+    double t = target.get_d();
+    double margin = 2 * (error + std::abs(t) * kRoundingBound);
+    if (estimate + margin < t) {
+        SOFA_PROFILE_COUNT(kAreaFiltered);
+        return -1;
+    }
+    if (estimate - margin > t) {
+        SOFA_PROFILE_COUNT(kAreaFiltered);
+        return 1;
+    }
+    return 0;
+}
+
+bool Sofa::estimate_child_area(
+        std::size_t idx,
+        HalveType t,
+        double &estimate,
+        double &error) const
+{
+    // an inherited gain has no proven bound
+    const HalveGainCache &g = gains[4*idx + t];
+    if (!g.computed())
+        return false;
+    double cut = g.exact.get_d();
+    estimate = area_estimate - cut;
+    error = area_error + (std::abs(area_estimate) + std::abs(cut)) * kRoundingBound;
+    return true;
+}
+
+void Sofa::set_area(mpq_class a)
+{
+    area_exact = std::move(a);
+    area_known = true;
+    area_estimate = area_exact.get_d();
+    area_error = std::abs(area_estimate) * kRoundingBound;
+}
+
+void Sofa::vertex_area(double &estimate, double &error) const
+{
+    // the shoelace formula over the rounded vertices, each off by 
+    // kRoundingBound relative to itself. Every product and sum adds 
+    // one more rounding, so with m terms the error of the sum is below 
+    // (m + 4) * kRoundingBound times the sum of the absolute values
+    // of the products, and area_error is twice the error of its half.
+    double res = 0, abs_sum = 0;
+    std::size_t num_terms = 0;
+    for (auto &poly : polygons) {
+        std::size_t p_size = poly.size();
+        if (p_size == 0)
+            continue;
+        const Coord &c = ctx.intersection_ref(poly[p_size - 1], poly[p_size - 2]);
+        double x0 = c.x.get_d(), y0 = c.y.get_d();
+        for (std::size_t i = 0; i < p_size; i++) {
+            const Coord &c1 = ctx.intersection_ref(
+                    poly[i], poly[(i + p_size - 1) % p_size]);
+            double x1 = c1.x.get_d(), y1 = c1.y.get_d();
+            res += x0 * y1 - y0 * x1;
+            abs_sum += std::abs(x0 * y1) + std::abs(y0 * x1);
+            x0 = x1;
+            y0 = y1;
+        }
+        num_terms += p_size + 1;
+    }
+    estimate = res / 2;
+    error = (num_terms + 4) * kRoundingBound * abs_sum;
+}
+
+ApproxPolygons Sofa::approx_polygons() const
+{
+    ApproxPolygons res;
+    for (auto &poly : polygons) {
+        ApproxPolygon ap(poly.size());
+        std::size_t prev_idx = poly.size() - 1;
+        for (std::size_t i = 0; i < poly.size(); i++) {
+            const Coord &c = ctx.intersection_ref(poly[i], poly[prev_idx]);
+            ap[i] = {c.x.get_d(), c.y.get_d()};
+            prev_idx = i;
+        }
+        res.push_back(std::move(ap));
+    }
+    return res;
+}
+
 std::vector< std::vector<Coord> > Sofa::coord_polygons()
 {
     std::vector< std::vector<Coord> > coord_polys;
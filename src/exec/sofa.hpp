@@ -7,6 +7,7 @@
 #include <utility>
 #include <tuple>
 
+#include "approx.hpp"
 #include "line_context.hpp"
 #include "region.hpp"
 #include "sofa_line_context.hpp"
@@ -25,12 +26,44 @@ struct Interval {
 
 enum HalveType {kMuDown, kMuUp, kNuDown, kNuUp};
 
+// halve_gain and approx_halve_gain of one (idx, HalveType) pair, 
+// kept from parent to child while the halving does not seem to touch them
+struct HalveGainCache {
+    bool exact_known, approx_known;
+    // whether exact was kept from an ancestor by inherit_gains, whose 
+    // test has no proven error bound, rather than computed on this sofa. 
+    // Such a gain only guides the choice of the policy.
+    bool inherited;
+    mpq_class exact;
+    double approx;
+
+    HalveGainCache() : 
+        exact_known(false), approx_known(false), inherited(false), approx(0) {}
+
+    // whether exact is the gain of this sofa for sure
+    bool computed() const {return exact_known && !inherited;}
+};
+
 // these should be sufficient for constructing a sofa data
 struct SofaParams {
     std::vector<Interval> mu_range, nu_range;
 
-    void write(FILE *file);
-    static SofaParams read(FILE *file);
+    // binary, with the numbers in the raw format of GMP.
+    // Both return false on an I/O error or a truncated file.
+    bool write(FILE *file) const;
+    static bool read(FILE *file, SofaParams &p);
+};
+
+// A sofa kept as its box only, to be rebuilt by Sofa::from_record
+struct SofaRecord {
+    SofaParams params;
+    std::size_t depth;
+    std::size_t root_idx;
+    mpq_class area;
+
+    // as SofaParams::write and read
+    bool write(FILE *file) const;
+    static bool read(FILE *file, SofaRecord &r);
 };
 
 struct SofaMetadata {
@@ -62,7 +95,14 @@ class Sofa {
         std::vector<Interval> mu_range, nu_range;
         SofaLineContext ctx;
         Polygons polygons;
-        mpq_class area;
+        // floating-point estimate of area() and a bound of its error
+        double area_estimate, area_error;
+        // number of halvings from the initial sofa
+        std::size_t depth;
+        // index of the initial sofa this one descends from
+        std::size_t root_idx;
+        // gains of the pair (idx, t) at gains[4*idx + t]
+        std::vector<HalveGainCache> gains;
 
         // normals should contain unit vectors
         // mu_range and nu_range should contain 
@@ -73,6 +113,33 @@ class Sofa {
                 std::vector<Interval> mu_range,
                 std::vector<Interval> nu_range,
                 std::size_t mu_fix_idx);
+        // The exact area, computed from the polygons on first use
+        // unless the child constructor could take it from the parent
+        const mpq_class &area() const;
+        // Whether area() < target, decided from area_estimate when it is 
+        // farther than its error from target. Most sofas are far from 
+        // the target, so their exact area is left to the few callers 
+        // that order sofas by area or record it.
+        bool area_below(const mpq_class &target) const;
+        // Whether an area of this estimate and error is below target:
+        // -1 if it is, 1 if not and 0 if the estimate cannot tell
+        static int compare_estimate(
+                double estimate, 
+                double error, 
+                const mpq_class &target);
+
+        // The box, depth, root and area of this sofa,
+        // and a sofa built back from them with the same polygons
+        SofaRecord record() const;
+        static Sofa *from_record(
+                const std::vector<Coord> &normals,
+                std::size_t mu_fix_idx,
+                const SofaRecord &r);
+
+        // number of band pairs of make_band_pairs for n normals,
+        // the n of SofaTables used by the sofas
+        static std::size_t num_band_pairs(std::size_t n) {return 2*n + 1;}
+
         static std::vector<Coord> mu_to_nu(std::vector<Coord> mu);
         static std::vector<BandPair> make_band_pairs(
                 const std::vector<Coord> &mu,
@@ -106,26 +173,95 @@ class Sofa {
                 const Sofa &other, 
                 std::size_t idx,
                 HalveType t);
+        // Makes this Sofa(other, idx, t) in place. A sofa of the same 
+        // search reuses its storage, so that this allocates little.
+        void assign_child(
+                const Sofa &other, 
+                std::size_t idx,
+                HalveType t);
+        // the estimate and error of the area of Sofa(*this, idx, t),
+        // without building it, from the exact gain of (idx, t).
+        // false unless this sofa has computed that gain itself.
+        bool estimate_child_area(
+                std::size_t idx,
+                HalveType t,
+                double &estimate,
+                double &error) const;
+        // the box of Sofa(*this, idx, t), without building it.
+        // No table of the boxes closed before is looked up with it, 
+        // as a search never reaches a box twice (see the readme).
+        SofaParams child_params(
+                std::size_t idx,
+                HalveType t) const;
+        static void halve_ranges(
+                std::vector<Interval> &mu_range,
+                std::vector<Interval> &nu_range,
+                std::size_t idx,
+                HalveType t);
 
-        std::vector<Coord> poly_to_coord(Polygon p);
+        std::vector<Coord> poly_to_coord(const Polygon &p);
         std::vector< std::vector<Coord> > coord_polygons();
-        mpq_class calc_area(Polygon p);
-        mpq_class calc_area(Polygons p);
+        mpq_class calc_area(const Polygon &p) const;
+        mpq_class calc_area(const Polygons &p) const;
+
+        // the part of polygons cut off by halving (idx, t) is
+        // the intersection of the half-planes with these boundaries
+        std::vector<LineId> halve_boundaries(
+                std::size_t idx,
+                HalveType t) const;
 
+        // area of the part cut off, cached in gains, 
+        // where it may be inherited from an ancestor,
+        // so calc_halve_gain is the one to check areas against
         mpq_class halve_gain(
                 std::size_t idx,
                 HalveType t);
+        // same without the cache
+        mpq_class calc_halve_gain(
+                std::size_t idx,
+                HalveType t);
+
+        // floating-point copy of the vertices of polygons
+        ApproxPolygons approx_polygons() const;
+        // estimate of halve_gain(idx, t) from approx_polygons(), 
+        // cached in gains
+        double approx_halve_gain(
+                const ApproxPolygons &approx,
+                std::size_t idx,
+                HalveType t);
+
+        // after halving `parent` by (idx, t), copies the gains 
+        // of the parent that the cut part does not seem to change,
+        // as tested in floating point. The copies are marked inherited.
+        void inherit_gains(
+                const Sofa &parent,
+                std::size_t idx,
+                HalveType t);
 
-        LineId hl() {return n*4;}
-        LineId hu() {return n*4+3;}
-        LineId ldd(std::size_t i) {return (i+n+1)*4;}
-        LineId ldu(std::size_t i) {return (i+n+1)*4+1;}
-        LineId lud(std::size_t i) {return (i+n+1)*4+2;}
-        LineId luu(std::size_t i) {return (i+n+1)*4+3;}
-        LineId rdd(std::size_t i) {return (i)*4;}
-        LineId rdu(std::size_t i) {return (i)*4+1;}
-        LineId rud(std::size_t i) {return (i)*4+2;}
-        LineId ruu(std::size_t i) {return (i)*4+3;}
+        LineId hl() const {return n*4;}
+        LineId hu() const {return n*4+3;}
+        LineId ldd(std::size_t i) const {return (i+n+1)*4;}
+        LineId ldu(std::size_t i) const {return (i+n+1)*4+1;}
+        LineId lud(std::size_t i) const {return (i+n+1)*4+2;}
+        LineId luu(std::size_t i) const {return (i+n+1)*4+3;}
+        LineId rdd(std::size_t i) const {return (i)*4;}
+        LineId rdu(std::size_t i) const {return (i)*4+1;}
+        LineId rud(std::size_t i) const {return (i)*4+2;}
+        LineId ruu(std::size_t i) const {return (i)*4+3;}
+
+    private:
+        // the cache of area()
+        mutable bool area_known;
+        mutable mpq_class area_exact;
+
+        void set_area(mpq_class a);
+        // the child constructor once the members are copied from other
+        void halve_from(
+                const Sofa &other,
+                std::size_t idx,
+                HalveType t);
+        // an estimate of the area and its error from the vertices
+        void vertex_area(double &estimate, double &error) const;
 };
 
 };
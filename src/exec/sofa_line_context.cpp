@@ -1,5 +1,7 @@
 #include "sofa_line_context.hpp"
 
+#include "profile.hpp"
+
 #include <cassert>
 #include <iostream>
 
@@ -12,7 +14,8 @@ SofaLineContext::SofaLineContext(
     branched_slope(kNoBranch),
 
     n(band_pairs.size()),
-    lines(0),
+    tables(&SofaTables::get(n)),
+    lines(),
     intersections(num_l2(n)),
 
     b3_to_determine (num_b3(n), true ),
@@ -27,6 +30,7 @@ SofaLineContext::SofaLineContext(
     }
 
     // each band_pair should have lines in increasing intercept
+    IntersectionStore &store = IntersectionStore::get();
     for (const auto &bp : band_pairs) {
         assert(bp.il.slope == bp.iu.slope);
         assert(bp.iu.slope == bp.ol.slope);
@@ -34,17 +38,21 @@ SofaLineContext::SofaLineContext(
         assert(bp.il.intercept < bp.iu.intercept);
         assert(bp.iu.intercept < bp.ol.intercept);
         assert(bp.ol.intercept < bp.ou.intercept);
-        lines.push_back(bp.il);
-        lines.push_back(bp.iu);
-        lines.push_back(bp.ol);
-        lines.push_back(bp.ou);
+        lines.push_back(store.line(bp.il));
+        lines.push_back(store.line(bp.iu));
+        lines.push_back(store.line(bp.ol));
+        lines.push_back(store.line(bp.ou));
+    }
+    for (const auto &l : lines) {
+        approx_slopes.push_back(l->slope.get_d());
+        approx_intercepts.push_back(l->intercept.get_d());
     }
 
     // update intersections
     for (std::size_t i = 0; i < num_l(n); i++) {
         for (std::size_t j = i + 1; j < num_l(n); j++) {
             if (slope_id(i) != slope_id(j)) {
-                intersections[make_l2(i, j)] = geometry::intersection(lines[i], lines[j]);
+                intersections[make_l2(i, j)] = intersection_explicit(i, j);
             }
         }
     }
@@ -58,7 +66,10 @@ SofaLineContext::SofaLineContext(
     branched_slope(bs),
 
     n(other.n),
+    tables(other.tables),
     lines(other.lines),
+    approx_slopes(other.approx_slopes),
+    approx_intercepts(other.approx_intercepts),
     intersections(other.intersections),
 
     b3_to_determine (other.b3_to_determine),
@@ -67,17 +78,39 @@ SofaLineContext::SofaLineContext(
     l3_arr_mem      (other.l3_arr_mem     )
 
 {
-    mpq_class &l_il_i = lines[l_il(bs)].intercept;
-    mpq_class &l_iu_i = lines[l_iu(bs)].intercept;
-    mpq_class &l_ol_i = lines[l_ol(bs)].intercept;
-    mpq_class &l_ou_i = lines[l_ou(bs)].intercept;
-    mpq_class igap = (l_ou_i - l_ol_i) / 2;
+    halve(other, bs, branch_direction);
+}
+
+void SofaLineContext::assign_child(
+        const SofaLineContext &other,
+        SlopeId bs,
+        BranchDirection branch_direction)
+{
+    // the vectors keep their storage, as they have the same sizes
+    *this = other;
+    branched_slope = bs;
+    halve(other, bs, branch_direction);
+}
+
+void SofaLineContext::halve(
+        const SofaLineContext &other,
+        SlopeId bs,
+        BranchDirection branch_direction)
+{
+    IntersectionStore &store = IntersectionStore::get();
+    // read from other, which keeps the old lines alive
+    const mpq_class &slope = other.lines[l_il(bs)]->slope;
+    const mpq_class &l_iu_i = other.lines[l_iu(bs)]->intercept;
+    const mpq_class &l_ol_i = other.lines[l_ol(bs)]->intercept;
+    mpq_class igap = (other.lines[l_ou(bs)]->intercept - l_ol_i) / 2;
 
     if (branch_direction == kDown) {
-        // l_il_i = l_il_i
-        l_iu_i -= igap;
-        l_ou_i = l_ol_i;
-        l_ol_i -= igap;
+        // il stays, ou moves to ol, and iu and ol move down by igap
+        SharedLine iu = store.line(Line(slope, l_iu_i - igap));
+        SharedLine ol = store.line(Line(slope, l_ol_i - igap));
+        lines[l_ou(bs)] = std::move(lines[l_ol(bs)]);
+        lines[l_iu(bs)] = std::move(iu);
+        lines[l_ol(bs)] = std::move(ol);
 
         // update intersections
         for (LineId l = 0; l < num_l(n); l++) {
@@ -95,18 +128,17 @@ SofaLineContext::SofaLineContext(
                 l2_ou = make_l2(l_ou(bs), l);
             }
             // trnasfer ol to ou
-            // how can I move
-            intersections[l2_ou] = Coord(intersections[l2_ol]);
+            intersections[l2_ou] = intersections[l2_ol];
             // update iu and ol
             intersections[l2_iu] = intersection_explicit(l, l_iu(bs));
             intersections[l2_ol] = intersection_explicit(l, l_ol(bs));
         }
 
         // update memory
-        const auto &l3_iu = l3_with_l(n, l_iu(bs));
-        const auto &l3_ol = l3_with_l(n, l_ol(bs));
-        const auto &l3_ou = l3_with_l(n, l_ou(bs));
-        for (std::size_t i = 0; i < l3_iu.size(); i++) {
+        const std::uint32_t *l3_iu = tables->l3_with_l(l_iu(bs));
+        const std::uint32_t *l3_ol = tables->l3_with_l(l_ol(bs));
+        const std::uint32_t *l3_ou = tables->l3_with_l(l_ou(bs));
+        for (std::size_t i = 0; i < tables->num_l3_with_l(); i++) {
             auto b3 = l3_to_b3(l3_iu[i]);
             // if the band triple is not determined, update
             if (!b3_determined[b3]) {
@@ -121,10 +153,12 @@ SofaLineContext::SofaLineContext(
             }
         }
     } else { // branch_drection == kUp
-        l_il_i = l_iu_i;
-        l_iu_i += igap;
-        l_ol_i += igap;
-        // l_ou_i = l_ou_i
+        // ou stays, il moves to iu, and iu and ol move up by igap
+        SharedLine iu = store.line(Line(slope, l_iu_i + igap));
+        SharedLine ol = store.line(Line(slope, l_ol_i + igap));
+        lines[l_il(bs)] = std::move(lines[l_iu(bs)]);
+        lines[l_iu(bs)] = std::move(iu);
+        lines[l_ol(bs)] = std::move(ol);
 
         // update intersections
         for (LineId l = 0; l < num_l(n); l++) {
@@ -149,10 +183,10 @@ SofaLineContext::SofaLineContext(
         }
 
         // update memory
-        const auto &l3_il = l3_with_l(n, l_il(bs));
-        const auto &l3_iu = l3_with_l(n, l_iu(bs));
-        const auto &l3_ol = l3_with_l(n, l_ol(bs));
-        for (std::size_t i = 0; i < l3_il.size(); i++) {
+        const std::uint32_t *l3_il = tables->l3_with_l(l_il(bs));
+        const std::uint32_t *l3_iu = tables->l3_with_l(l_iu(bs));
+        const std::uint32_t *l3_ol = tables->l3_with_l(l_ol(bs));
+        for (std::size_t i = 0; i < tables->num_l3_with_l(); i++) {
             auto b3 = l3_to_b3(l3_il[i]);
             // if the band triple is not determined, update
             if (!b3_determined[b3]) {
@@ -168,6 +202,8 @@ SofaLineContext::SofaLineContext(
         }
     }
 
+    for (LineId l = l_il(bs); l <= l_ou(bs); l++)
+        approx_intercepts[l] = lines[l]->intercept.get_d();
 }
 
 SofaLineContext::~SofaLineContext()
@@ -176,10 +212,11 @@ SofaLineContext::~SofaLineContext()
 }
 
 LineArrangement SofaLineContext::arrangement(
-        LineId id0, LineId id1, LineId id2)
+        LineId id0, LineId id1, LineId id2) const
 {
     int l3 = make_l3(id0, id1, id2);
     if (l3_arr_known[l3]) {
+        SOFA_PROFILE_COUNT(kArrangementCached);
         return l3_arr_mem[l3];
     } else {
         upd_l3(id0, id1, id2, l3);
@@ -190,7 +227,7 @@ LineArrangement SofaLineContext::arrangement(
 typedef std::vector<bool>::reference bref;
 
 void SofaLineContext::upd_l3(
-        short id0, short id1, short id2, short l3)
+        short id0, short id1, short id2, short l3) const
 {
     short b3 = l3_to_b3(l3);
     if (arrangement_explicit(id0, id1, id2) == kV) {
@@ -2,16 +2,19 @@
 #define SOFA_LINE_CONTEXT_HPP
 
 #include <cassert>
+#include <cmath>
 #include <vector>
-#include <map>
 #include <tuple>
 #include <iostream>
 
 #include <gmp.h>
 #include <gmpxx.h>
 
+#include "intersection_store.hpp"
 #include "line.hpp"
 #include "line_context.hpp"
+#include "profile.hpp"
+#include "sofa_tables.hpp"
 
 namespace sofa_designer {
 namespace sofa {
@@ -73,7 +76,7 @@ typedef short BandId;
 
 enum BranchDirection {kDown, kUp};
 
-class SofaLineContext : public LineContext {
+class SofaLineContext final : public LineContext {
     public:
         // does sanity check for given `band_pairs`
         SofaLineContext(
@@ -89,6 +92,12 @@ class SofaLineContext : public LineContext {
         ~SofaLineContext();
         SofaLineContext &operator=(const SofaLineContext &other) = default;
         SofaLineContext &operator=(SofaLineContext &&other) = default;
+        // Makes this SofaLineContext(other, branch_slope, branch_direction)
+        // in place, reusing the storage of this
+        void assign_child(
+                const SofaLineContext &other,
+                SlopeId branch_slope,
+                BranchDirection branch_direction);
 
         std::size_t num_lines() const
         {
@@ -96,30 +105,41 @@ class SofaLineContext : public LineContext {
         }
         Line line(LineId id) const
         {
-            return lines[id];
+            return *lines[id];
         }
         std::vector<Line> all_lines() const
         {
-            return lines;
+            std::vector<Line> res;
+            for (const auto &l : lines)
+                res.push_back(*l);
+            return res;
         }
         Coord intersection(
                 LineId id0, LineId id1) const
+        {
+            return intersection_ref(id0, id1);
+        }
+        // the same without a copy, valid while the context lives
+        const Coord &intersection_ref(
+                LineId id0, LineId id1) const
         {
             if (id0 < 0)
                 id0 = ~id0;
             if (id1 < 0)
                 id1 = ~id1;
             if (id0 < id1)
-                return intersections[make_l2(id0, id1)];
+                return *intersections[make_l2(id0, id1)];
             else
-                return intersections[make_l2(id1, id0)];
+                return *intersections[make_l2(id1, id0)];
         }
         SlopeId slope_id(LineId id) const {return id/4;}
 
+        // answered from a cache of arrangements filled by this call,
+        // hence the mutable members below
         LineArrangement arrangement(
                 LineId id0, 
                 LineId id1, 
-                LineId id2);
+                LineId id2) const;
 
     private:
         // making it const short makes the class non-movable.
@@ -127,17 +147,31 @@ class SofaLineContext : public LineContext {
         short branched_slope;
 
         std::size_t n;
-        std::vector<Line> lines;
-        std::vector<Coord> intersections;
+        // shared by all contexts with the same n
+        const SofaTables *tables;
+        // interned in the IntersectionStore, so that a child copies 
+        // pointers and intersections are looked up by them
+        std::vector<SharedLine> lines;
+        // lines rounded to double, for arrangement_filter
+        std::vector<double> approx_slopes, approx_intercepts;
+        // held in the IntersectionStore as well
+        std::vector<SharedCoord> intersections;
        
         // for any triple of band, store the info of whether they have fixed arrangement
-        std::vector<bool> b3_to_determine;
+        mutable std::vector<bool> b3_to_determine;
         // if they have same shape, set it to true
-        std::vector<bool> b3_determined;
+        mutable std::vector<bool> b3_determined;
         // whether l3_arr_mem is correct
-        std::vector<bool> l3_arr_known;
+        mutable std::vector<bool> l3_arr_known;
         // stores partial info of arrangement
-        std::vector<bool> l3_arr_mem; 
+        mutable std::vector<bool> l3_arr_mem; 
+
+        // the branching constructor after copying other:
+        // moves the lines of slope bs and updates what depends on them
+        void halve(
+                const SofaLineContext &other,
+                SlopeId bs,
+                BranchDirection branch_direction);
 
         inline static LineId l_il(SlopeId s) { return 4*s; }
         inline static LineId l_iu(SlopeId s) { return 4*s+1; }
@@ -154,93 +188,85 @@ class SofaLineContext : public LineContext {
         inline static std::size_t num_l3(std::size_t n) { return 64*comb3(n); }
         inline static std::size_t l3_to_b3(std::size_t l3) { return l3/8; }
 
-        inline thread_local static std::size_t make_b3(BandId id0, BandId id1, BandId id2)
+        std::size_t make_l2(LineId id0, LineId id1) const
         {
-            thread_local static std::vector<std::size_t> ii0(0), ii1(0), ii2(0);
-            if (ii0.size() <= id2) {
-                std::size_t mval = ii0.size();
-                ii0.resize(id2 + 1);
-                ii1.resize(id2 + 1);
-                ii2.resize(id2 + 1);
-                for (std::size_t i = mval; i <= id2; i++) {
-                    ii0[i] = 8*(i/2)+i%2;
-                    ii1[i] = 8*comb2(i/2)+i%2*2;
-                    ii2[i] = 8*comb3(i/2)+i%2*4;
-                }
-            }
-            assert(ii0[id0] + ii1[id1] + ii2[id2] >= 0);
-            assert(ii0[id0] + ii1[id1] + ii2[id2] < num_b3(id2 + 1));
-            return ii0[id0] + ii1[id1] + ii2[id2];
+            return tables->l2(id0, id1);
         }
-        inline thread_local static std::size_t make_l2(LineId id0, LineId id1)
+        // assume id0 < id1 < id2;
+        std::size_t make_l3(LineId id0, LineId id1, LineId id2) const
         {
-            assert(0 <= id0);
-            assert(id0 < id1);
-            thread_local static std::vector<std::size_t> ii0(0), ii1(0);
-            if (ii0.size() <= id1) {
-                std::size_t mval = ii0.size();
-                ii0.resize(id1 + 1);
-                ii1.resize(id1 + 1);
-                for (std::size_t i = mval; i <= id1; i++) {
-                    ii0[i] = 16*(i/4)+i%4;
-                    ii1[i] = 16*comb2(i/4)+i%4*4;
-                }
-            }
-            return ii0[id0] + ii1[id1];
+            return tables->l3(id0, id1, id2);
         }
-        // assume id0 < id1 < id2;
-        inline thread_local static std::size_t make_l3(LineId id0, LineId id1, LineId id2) 
+
+        // The sign of b0(s2-s1) + b1(s0-s2) + b2(s1-s0) for the slopes s
+        // and intercepts b of id0 < id1 < id2, which is the sign of 
+        // the height of the intersection of id0 and id2 above id1,
+        // computed in double: 1 for kV, -1 for kU 
+        // and 0 when the rounding error may change the sign
+        int arrangement_filter(
+                LineId id0, 
+                LineId id1, 
+                LineId id2) const
         {
-            assert(0 <= id0);
-            assert(id0 < id1);
-            assert(id1 < id2);
-            thread_local static std::vector<std::size_t> ii0(0), ii1(0), ii2(0);
-            if (ii0.size() <= id2) {
-                std::size_t mval = ii0.size();
-                ii0.resize(id2 + 1);
-                ii1.resize(id2 + 1);
-                ii2.resize(id2 + 1);
-                for (std::size_t i = mval; i <= id2; i++) {
-                    ii0[i] = 64*(i/4)+(i&2)/2*8+(i&1);
-                    ii1[i] = 64*comb2(i/4)+(i&2)/2*16+(i&1)*2;
-                    ii2[i] = 64*comb3(i/4)+(i&2)/2*32+(i&1)*4;
-                }
-            }
-            assert(ii0[id0] + ii1[id1] + ii2[id2] >= 0);
-            assert(ii0[id0] + ii1[id1] + ii2[id2] < num_l3(id2 + 1));
-            return ii0[id0] + ii1[id1] + ii2[id2];
+            double s0 = approx_slopes[id0], b0 = approx_intercepts[id0];
+            double s1 = approx_slopes[id1], b1 = approx_intercepts[id1];
+            double s2 = approx_slopes[id2], b2 = approx_intercepts[id2];
+            double det = b0*(s2 - s1) + b1*(s0 - s2) + b2*(s1 - s0);
+            // With u = 2^-53, each input is within 2u relative to its 
+            // exact value. A term b_i * (s_j - s_k) is then off by 
+            // 2u (b_i) + 2u (s_j, s_k) + u (subtraction) + u (product) 
+            // + 2u (the two sums) of |b_i| (|s_j| + |s_k|), plus terms 
+            // in u^2, so |det - exact| <= (8u + O(u^2)) * mag.
+            // The mag computed here is within 8u of the exact one,
+            // so 16u * mag leaves a margin of about 8u * mag over 
+            // 8u * exact mag for the terms in u^2.
+            double mag = std::abs(b0)*(std::abs(s2) + std::abs(s1)) +
+                std::abs(b1)*(std::abs(s0) + std::abs(s2)) +
+                std::abs(b2)*(std::abs(s1) + std::abs(s0));
+            double err = mag * (16.0 / 9007199254740992.0); // 16 * 2^-53
+            if (det > err)
+                return 1;
+            if (det < -err)
+                return -1;
+            return 0;
         }
 
         LineArrangement arrangement_explicit(
                 LineId id0, 
                 LineId id1, 
-                LineId id2)
+                LineId id2) const
         {
-            if (lines[id1].parallel_intercept(intersection(id0, id2)) >= // the sign
-                    lines[id1].intercept)
+            int sign = arrangement_filter(id0, id1, id2);
+            if (sign) {
+                SOFA_PROFILE_COUNT(kArrangementFiltered);
+                return sign > 0 ? kV : kU;
+            }
+            SOFA_PROFILE_COUNT(kArrangementExact);
+            if (lines[id1]->parallel_intercept(intersection_ref(id0, id2)) >= // the sign
+                    lines[id1]->intercept)
                 return kV;
             else
                 return kU;
         }
 
-        Coord intersection_explicit(
-                LineId id0, LineId id1)
+        SharedCoord intersection_explicit(
+                LineId id0, LineId id1) const
         {
-            return lines[id0].intersection(lines[id1]);
+            return IntersectionStore::get().intersection(lines[id0], lines[id1]);
         }
 
-        Line upper(BandId bid) {
-            Line l(lines[2*bid]);
-            l.intercept = 2*lines[2*bid+1].intercept - lines[2*bid].intercept;
+        Line upper(BandId bid) const {
+            Line l(*lines[2*bid]);
+            l.intercept = 2*lines[2*bid+1]->intercept - lines[2*bid]->intercept;
             return l;
         };
-        Line lower(BandId bid) {
-            Line l(lines[2*bid]);
-            l.intercept = 2*lines[2*bid].intercept - lines[2*bid+1].intercept;
+        Line lower(BandId bid) const {
+            Line l(*lines[2*bid]);
+            l.intercept = 2*lines[2*bid]->intercept - lines[2*bid+1]->intercept;
             return l;
         };
 
-        void determine_b3_kV(short bid0, short bid1, short bid2, short b3) 
+        void determine_b3_kV(short bid0, short bid1, short bid2, short b3) const
         {
             if (geometry::arrangement_general(lower(bid0), upper(bid1), lower(bid2)) == kV) {
                 b3_determined[b3] = true;
@@ -252,7 +278,7 @@ class SofaLineContext : public LineContext {
             }
         }
 
-        void determine_b3_kU(short bid0, short bid1, short bid2, short b3) 
+        void determine_b3_kU(short bid0, short bid1, short bid2, short b3) const
         {
             if (geometry::arrangement_general(upper(bid0), lower(bid1), upper(bid2)) == kU) {
                 b3_determined[b3] = true;
@@ -264,35 +290,7 @@ class SofaLineContext : public LineContext {
             }
         }
 
-        void upd_l3(short id0, short id1, short id2, short l3);
-        thread_local static const std::vector<short> &l3_with_l(std::size_t n, LineId l) {
-
-            thread_local static std::map<
-                std::tuple<std::size_t, LineId>, 
-                std::vector<short> 
-                    > mem;
-
-            if (mem.count(std::make_pair(n, l))) {
-                return mem[std::make_pair(n, l)];
-            } else {
-                auto &l3s = mem[std::make_pair(n, l)];
-                l3s.clear();
-                auto s = l/4;
-                for (LineId id0 = 0; id0 < num_l(n); id0++)
-                    if (id0/4 != s)
-                        for (LineId id1 = id0 + 1; id1 < num_l(n); id1++)
-                            if (id1/4 != s && id1/4 != id0/4)
-                            {
-                                if (l < id0)
-                                    l3s.push_back(make_l3(l, id0, id1));
-                                else if (l < id1)
-                                    l3s.push_back(make_l3(id0, l, id1));
-                                else
-                                    l3s.push_back(make_l3(id0, id1, l));
-                            }
-                return l3s;
-            }
-        };
+        void upd_l3(short id0, short id1, short id2, short l3) const;
 };
 
 };
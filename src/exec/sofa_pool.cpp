@@ -0,0 +1,36 @@
+#include "sofa_pool.hpp"
+
+namespace sofa_designer {
+namespace sofa {
+
+const std::size_t SofaPool::kDefaultMaxKept;
+
+SofaPool::~SofaPool()
+{
+    for (Sofa *s : kept)
+        delete s;
+}
+
+Sofa *SofaPool::child(const Sofa &parent, std::size_t idx, HalveType t)
+{
+    if (kept.empty()) {
+        num_allocated++;
+        return new Sofa(parent, idx, t);
+    }
+    Sofa *s = kept.back();
+    kept.pop_back();
+    num_reused++;
+    s->assign_child(parent, idx, t);
+    return s;
+}
+
+void SofaPool::recycle(Sofa *s)
+{
+    if (kept.size() < max_kept)
+        kept.push_back(s);
+    else
+        delete s;
+}
+
+}; // namespace sofa
+}; // namespace sofa_designer
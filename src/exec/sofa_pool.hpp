@@ -0,0 +1,51 @@
+#ifndef SOFA_POOL_HPP
+#define SOFA_POOL_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "sofa.hpp"
+
+namespace sofa_designer {
+namespace sofa {
+
+// Sofas freed by one worker, kept to build its next children in.
+// A sofa of a search has vectors of the same sizes as any other,
+// so Sofa::assign_child reuses them and their GMP numbers instead
+// of freeing and allocating them again.
+//
+// Sofas taken from and given to the pool are ordinary heap objects,
+// so a sofa may be built by one pool and deleted elsewhere.
+// A kept sofa still holds its lines and intersections in the
+// IntersectionStore, hence the small number kept.
+class SofaPool {
+    public:
+        struct Stats {
+            unsigned long long num_reused, num_allocated;
+        };
+
+        SofaPool(std::size_t max_kept = kDefaultMaxKept) : 
+            max_kept(max_kept), num_reused(0), num_allocated(0) {}
+        SofaPool(const SofaPool &other) = delete;
+        SofaPool &operator=(const SofaPool &other) = delete;
+        ~SofaPool();
+
+        // Sofa(parent, idx, t), built in a kept sofa if there is one
+        Sofa *child(const Sofa &parent, std::size_t idx, HalveType t);
+        // Keeps s for a later child, or deletes it if the pool is full
+        void recycle(Sofa *s);
+
+        Stats stats() const {return {num_reused, num_allocated};}
+
+        static const std::size_t kDefaultMaxKept = 16;
+
+    private:
+        std::size_t max_kept;
+        std::vector<Sofa*> kept;
+        unsigned long long num_reused, num_allocated;
+};
+
+}; // namespace sofa
+}; // namespace sofa_designer
+
+#endif // SOFA_POOL_HPP
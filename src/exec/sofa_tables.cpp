@@ -0,0 +1,162 @@
+#include "sofa_tables.hpp"
+
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sofa_designer {
+namespace sofa {
+
+static std::mutex registry_mutex;
+static std::map< std::size_t, std::unique_ptr<SofaTables> > registry;
+
+const SofaTables &SofaTables::get(std::size_t n)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    auto &t = registry[n];
+    if (!t)
+        t.reset(new SofaTables(build(n)));
+    return *t;
+}
+
+bool SofaTables::load(const std::string &path, std::size_t n)
+{
+    std::unique_ptr<SofaTables> t(map(path, n));
+    if (!t) {
+        // write to a temporary file first, so that other processes
+        // never map a partial file
+        std::vector<std::uint32_t> words = build(n);
+        std::string tmp_path = path + ".tmp" + std::to_string(getpid());
+        FILE *file = std::fopen(tmp_path.c_str(), "wb");
+        if (!file)
+            return false;
+        bool ok = (std::fwrite(words.data(), sizeof(std::uint32_t), 
+                    words.size(), file) == words.size());
+        ok = (std::fclose(file) == 0) && ok;
+        ok = ok && std::rename(tmp_path.c_str(), path.c_str()) == 0;
+        if (!ok) {
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+        t.reset(map(path, n));
+        if (!t)
+            return false;
+    }
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    // contexts already built keep the tables they point to
+    if (!registry[n])
+        registry[n] = std::move(t);
+    return registry[n]->is_mapped();
+}
+
+SofaTables::~SofaTables()
+{
+    if (is_mapped())
+        munmap(const_cast<std::uint32_t *>(words), mapped_size);
+}
+
+SofaTables::SofaTables(std::vector<std::uint32_t> owned) :
+    owned(std::move(owned)),
+    mapped_size(0)
+{
+    words = this->owned.data();
+    set_pointers();
+}
+
+SofaTables::SofaTables(const std::uint32_t *mapped, std::size_t mapped_size) :
+    words(mapped),
+    mapped_size(mapped_size)
+{
+    set_pointers();
+}
+
+std::size_t SofaTables::num_words(std::size_t n)
+{
+    std::size_t num_l = 4*n;
+    return kHeaderSize + 5*num_l + num_l * 16*comb2(n - 1);
+}
+
+std::vector<std::uint32_t> SofaTables::build(std::size_t n)
+{
+    assert(n >= 1);
+    std::size_t num_l = 4*n;
+    std::vector<std::uint32_t> res(num_words(n));
+    res[kMagic] = kMagicWord;
+    res[kVersion] = kVersionWord;
+    res[kN] = n;
+    res[kNumWords] = res.size();
+
+    std::uint32_t *p = res.data() + kHeaderSize;
+    std::uint32_t *l2_0 = p, *l2_1 = p + num_l;
+    std::uint32_t *l3_0 = p + 2*num_l, *l3_1 = p + 3*num_l, *l3_2 = p + 4*num_l;
+    for (std::size_t i = 0; i < num_l; i++) {
+        l2_0[i] = 16*(i/4)+i%4;
+        l2_1[i] = 16*comb2(i/4)+i%4*4;
+        l3_0[i] = 64*(i/4)+(i&2)/2*8+(i&1);
+        l3_1[i] = 64*comb2(i/4)+(i&2)/2*16+(i&1)*2;
+        l3_2[i] = 64*comb3(i/4)+(i&2)/2*32+(i&1)*4;
+    }
+
+    std::uint32_t *l3s = p + 5*num_l;
+    for (std::size_t l = 0; l < num_l; l++) {
+        auto s = l/4;
+        for (std::size_t id0 = 0; id0 < num_l; id0++)
+            if (id0/4 != s)
+                for (std::size_t id1 = id0 + 1; id1 < num_l; id1++)
+                    if (id1/4 != s && id1/4 != id0/4) {
+                        std::size_t a = l, b = id0, c = id1;
+                        if (l > id1)
+                            a = id0, b = id1, c = l;
+                        else if (l > id0)
+                            a = id0, b = l, c = id1;
+                        *l3s++ = l3_0[a] + l3_1[b] + l3_2[c];
+                    }
+    }
+    assert(l3s == res.data() + res.size());
+    return res;
+}
+
+SofaTables *SofaTables::map(const std::string &path, std::size_t n)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+    struct stat st;
+    std::size_t size = num_words(n) * sizeof(std::uint32_t);
+    if (fstat(fd, &st) != 0 || std::size_t(st.st_size) != size) {
+        close(fd);
+        return nullptr;
+    }
+    void *addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        return nullptr;
+    const std::uint32_t *w = static_cast<const std::uint32_t *>(addr);
+    if (w[kMagic] != kMagicWord || w[kVersion] != kVersionWord || 
+            w[kN] != n || w[kNumWords] != num_words(n)) {
+        munmap(addr, size);
+        return nullptr;
+    }
+    return new SofaTables(w, size);
+}
+
+void SofaTables::set_pointers()
+{
+    std::size_t num_l = 4*n();
+    const std::uint32_t *p = words + kHeaderSize;
+    l2_0 = p;
+    l2_1 = p + num_l;
+    l3_0 = p + 2*num_l;
+    l3_1 = p + 3*num_l;
+    l3_2 = p + 4*num_l;
+    l3s = p + 5*num_l;
+}
+
+};
+};
@@ -0,0 +1,96 @@
+#ifndef SOFA_TABLES_HPP
+#define SOFA_TABLES_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "line_context.hpp"
+
+namespace sofa_designer {
+namespace sofa {
+
+using geometry::LineId;
+
+// Index tables of SofaLineContext, which depend only on the number
+// of slopes n: the offsets making the indices of pairs and triples
+// of lines (make_l2, make_l3) and, for each line, the triples of lines
+// of distinct slopes that contain it (l3_with_l).
+//
+// The tables of each n are built once per process and shared by all
+// threads. They are one flat array of 32-bit words, so that they can
+// also be written to a file once and mapped read-only by every process
+// on a node, sharing the page cache.
+class SofaTables {
+    public:
+        // The tables for n slopes, mapped by load() or built on first use
+        static const SofaTables &get(std::size_t n);
+        // Maps the tables for n slopes from `path`, after writing 
+        // them there if the file is missing or for another n.
+        // Returns whether the file is used.
+        static bool load(const std::string &path, std::size_t n);
+
+        ~SofaTables();
+        SofaTables(const SofaTables &other) = delete;
+        SofaTables &operator=(const SofaTables &other) = delete;
+
+        std::size_t n() const {return words[kN];}
+        // whether the words are mapped from a file
+        bool is_mapped() const {return mapped_size != 0;}
+
+        std::size_t l2(LineId id0, LineId id1) const
+        {
+            assert(0 <= id0);
+            assert(id0 < id1);
+            assert(std::size_t(id1) < 4*n());
+            return l2_0[id0] + l2_1[id1];
+        }
+        // assume id0 < id1 < id2
+        std::size_t l3(LineId id0, LineId id1, LineId id2) const
+        {
+            assert(0 <= id0);
+            assert(id0 < id1);
+            assert(id1 < id2);
+            assert(std::size_t(id2) < 4*n());
+            return l3_0[id0] + l3_1[id1] + l3_2[id2];
+        }
+        // Triples of lines containing l, as indices of l3().
+        // For two lines of the same slope, the i-th triples of both 
+        // consist of the same other two lines.
+        const std::uint32_t *l3_with_l(LineId l) const
+        {
+            return l3s + std::size_t(l) * num_l3_with_l();
+        }
+        std::size_t num_l3_with_l() const {return 16*comb2(n() - 1);}
+
+        static std::size_t comb2(std::size_t n) {return n*(n-1)/2;}
+        static std::size_t comb3(std::size_t n) {return n*(n-1)*(n-2)/6;}
+
+    private:
+        // header words
+        enum {kMagic, kVersion, kN, kNumWords, kHeaderSize};
+        static const std::uint32_t kMagicWord = 0x736f6661; // "sofa"
+        static const std::uint32_t kVersionWord = 1;
+
+        // either owned or mapped
+        std::vector<std::uint32_t> owned;
+        const std::uint32_t *words;
+        std::size_t mapped_size;
+        const std::uint32_t *l2_0, *l2_1, *l3_0, *l3_1, *l3_2, *l3s;
+
+        SofaTables(std::vector<std::uint32_t> owned);
+        SofaTables(const std::uint32_t *mapped, std::size_t mapped_size);
+
+        static std::vector<std::uint32_t> build(std::size_t n);
+        static std::size_t num_words(std::size_t n);
+        // the tables mapped from path, or null if it does not hold them
+        static SofaTables *map(const std::string &path, std::size_t n);
+        void set_pointers();
+};
+
+};
+};
+
+#endif // SOFA_TABLES_HPP
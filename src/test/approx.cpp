@@ -0,0 +1,42 @@
+#include "catch.hpp"
+
+#include "approx.hpp"
+
+namespace sofa_designer {
+namespace geometry {
+
+TEST_CASE( "Clipping floating-point polygons by half-planes", "[Approx]" ) {
+    ApproxPolygon square = {{0, 0}, {2, 0}, {2, 2}, {0, 2}};
+    REQUIRE(approx_area(square) == Approx(4));
+
+    // y = 1 cuts the square in halves
+    ApproxLine mid(Line(0, 1));
+    REQUIRE(approx_area(approx_clip(square, mid, true)) == Approx(2));
+    REQUIRE(approx_area(approx_clip(square, mid, false)) == Approx(2));
+
+    // y = x - 1 cuts off the lower right corner
+    ApproxLine diag(Line(1, -1));
+    REQUIRE(approx_area(approx_clip(square, diag, true)) == Approx(3.5));
+    REQUIRE(approx_area(approx_clip(square, diag, false)) == Approx(0.5));
+
+    // lines missing the polygon
+    REQUIRE(approx_clip(square, ApproxLine(Line(0, 3)), true).empty());
+    REQUIRE(approx_area(approx_clip(square, ApproxLine(Line(0, 3)), false)) 
+            == Approx(4));
+}
+
+TEST_CASE( "Clipping a nonconvex polygon into two pieces", "[Approx]" ) {
+    // U-shape opening upwards, cut by y = 2 into two prongs
+    ApproxPolygon u = {
+        {0, 0}, {3, 0}, {3, 3}, {2, 3}, {2, 1}, {1, 1}, {1, 3}, {0, 3}
+    };
+    REQUIRE(approx_area(u) == Approx(7));
+    ApproxLine l(Line(0, 2));
+    REQUIRE(approx_area(approx_clip(u, l, true)) == Approx(2));
+    REQUIRE(approx_area(approx_clip(u, l, false)) == Approx(5));
+    ApproxPolygons pieces = {approx_clip(u, l, true), approx_clip(u, l, false)};
+    REQUIRE(approx_area(pieces) == Approx(7));
+}
+
+}; // namespace geometry
+}; // namespace sofa_designer
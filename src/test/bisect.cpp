@@ -0,0 +1,48 @@
+#include "catch.hpp"
+
+#include <vector>
+
+#include <gmp.h>
+#include <gmpxx.h>
+
+#include "bisect.hpp"
+#include "fixtures.hpp"
+
+namespace sofa_designer {
+namespace search {
+
+using sofa::Coord;
+
+TEST_CASE( "Bisection brackets the lowest certified target", "[Bisect]" ) {
+    SearchConfig config = test::search_config(2, 50);
+    // searches longer than this fail, which keeps the test deterministic
+    config.node_budget = 300;
+    BisectConfig bisect;
+    bisect.time_budget = 600;
+    bisect.tolerance = 1_mpq/100_mpz;
+    bisect.step = 1_mpq/20_mpz;
+
+    BisectResult res = bisect_target(
+            Sofa::a_priori_sofas(test::three_normals(), 1, 2),
+            27_mpq/10_mpz, 1, config, bisect, nullptr);
+    REQUIRE(res.has_certified);
+    REQUIRE(res.has_failed);
+    REQUIRE(res.failed < res.certified);
+    REQUIRE(res.certified - res.failed <= bisect.tolerance);
+    REQUIRE(res.attempts.size() > 2);
+    REQUIRE(res.attempts[0].target == 27_mpq/10_mpz);
+    REQUIRE(res.attempts[0].num_reopened == 0);
+    for (const auto &a : res.attempts)
+        REQUIRE(a.num_iter <= 300);
+
+    // a fresh search certifies the same target
+    config.node_budget = 0;
+    SearchStats stats;
+    auto sofas = run_search(
+            Sofa::a_priori_sofas(test::three_normals(), 1, 2),
+            res.certified, 1, config, stats);
+    REQUIRE(sofas.empty());
+}
+
+}; // namespace search
+}; // namespace sofa_designer
@@ -0,0 +1,29 @@
+#include "fixtures.hpp"
+
+#include <gmpxx.h>
+
+namespace sofa_designer {
+namespace test {
+
+std::vector<Coord> three_normals()
+{
+    return {
+        Coord(24_mpq/25_mpz, 7_mpq/25_mpz),
+        Coord(120_mpq/169_mpz, 119_mpq/169_mpz),
+        Coord(7_mpq/25_mpz, 24_mpq/25_mpz),
+    };
+}
+
+SearchConfig search_config(std::size_t num_threads,
+        std::size_t num_iter_per_batch)
+{
+    SearchConfig config;
+    config.num_threads = num_threads;
+    config.num_iter_per_batch = num_iter_per_batch;
+    config.num_roots = 2;
+    config.print_progress = false;
+    return config;
+}
+
+}; // namespace test
+}; // namespace sofa_designer
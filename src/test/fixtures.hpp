@@ -0,0 +1,26 @@
+#ifndef TEST_FIXTURES_HPP
+#define TEST_FIXTURES_HPP
+
+#include <cstddef>
+#include <vector>
+
+#include "search.hpp"
+
+namespace sofa_designer {
+namespace test {
+
+using geometry::Coord;
+using search::SearchConfig;
+
+// The 3-angle Pythagorean normals shared by the search tests,
+// whose a priori sofas are closed at target 27/10
+std::vector<Coord> three_normals();
+
+// A quiet search over the two initial sofas of `three_normals`
+SearchConfig search_config(std::size_t num_threads,
+        std::size_t num_iter_per_batch);
+
+}; // namespace test
+}; // namespace sofa_designer
+
+#endif // TEST_FIXTURES_HPP
@@ -0,0 +1,159 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <tuple>
+#include <vector>
+
+#include <gmp.h>
+#include <gmpxx.h>
+
+#include "frontier.hpp"
+#include "search.hpp"
+#include "fixtures.hpp"
+
+namespace sofa_designer {
+namespace search {
+
+// the sofas of the first levels of the greedy search tree
+static std::vector<Sofa*> tree_sofas(std::size_t num)
+{
+    std::vector<Sofa*> res = Sofa::a_priori_sofas(test::three_normals(), 1, 2);
+    for (std::size_t i = 0; res.size() < num; i++) {
+        Sofa *s1, *s2;
+        std::tie(s1, s2) = branch(res[i], 1);
+        res.push_back(s1);
+        res.push_back(s2);
+    }
+    return res;
+}
+
+TEST_CASE( "Sofa records are written and read back", "[Frontier]" ) {
+    std::vector<Sofa*> sofas = tree_sofas(8);
+    FILE *file = std::tmpfile();
+    REQUIRE(file);
+    for (Sofa *s : sofas)
+        REQUIRE(s->record().write(file));
+    std::rewind(file);
+    for (Sofa *s : sofas) {
+        SofaRecord r;
+        REQUIRE(SofaRecord::read(file, r));
+        REQUIRE(r.params.mu_range.size() == s->n);
+        for (std::size_t i = 0; i < s->n; i++) {
+            REQUIRE(r.params.mu_range[i].min == s->mu_range[i].min);
+            REQUIRE(r.params.mu_range[i].max == s->mu_range[i].max);
+            REQUIRE(r.params.nu_range[i].min == s->nu_range[i].min);
+            REQUIRE(r.params.nu_range[i].max == s->nu_range[i].max);
+        }
+        REQUIRE(r.depth == s->depth);
+        REQUIRE(r.root_idx == s->root_idx);
+        REQUIRE(r.area == s->area());
+        delete s;
+    }
+    // nothing left to read
+    SofaRecord r;
+    REQUIRE(!SofaRecord::read(file, r));
+    std::fclose(file);
+}
+
+TEST_CASE( "Frontier keeps the sofas it cannot spill", "[Frontier]" ) {
+    std::vector<Sofa*> sofas = tree_sofas(10);
+    Frontier frontier(test::three_normals(), 1, 4, "/nonexistent-spill-dir");
+    REQUIRE(!frontier.push(sofas));
+    REQUIRE(frontier.failed);
+    REQUIRE(frontier.num_spilled == 0);
+    REQUIRE(frontier.size() == sofas.size());
+    for (Sofa *s : frontier.pop(frontier.size()))
+        delete s;
+
+    // the search stops without certifying the target
+    SearchConfig config = test::search_config(2, 5);
+    config.max_in_memory = 4;
+    config.spill_dir = "/nonexistent-spill-dir";
+    SearchStats stats;
+    auto open = run_search(
+            Sofa::a_priori_sofas(test::three_normals(), 1, 2),
+            27_mpq/10_mpz, 1, config, stats);
+    REQUIRE(stats.spill_failed);
+    REQUIRE(open.size() > 0);
+    REQUIRE(stats.closed_volume(2) < 1);
+    for (Sofa *s : open)
+        delete s;
+}
+
+TEST_CASE( "Frontier hands out sofas by decreasing area", "[Frontier]" ) {
+    for (std::size_t max_in_memory : {0, 1, 4}) {
+        std::vector<Sofa*> sofas = tree_sofas(40);
+        std::vector<mpq_class> areas;
+        for (Sofa *s : sofas)
+            areas.push_back(s->area());
+        std::sort(areas.begin(), areas.end(), std::greater<mpq_class>());
+
+        Frontier frontier(test::three_normals(), 1, max_in_memory);
+        // push in two parts, popping some in between
+        std::vector<Sofa*> rest(sofas.begin() + 20, sofas.end());
+        sofas.resize(20);
+        frontier.push(sofas);
+        std::vector<Sofa*> popped = frontier.pop(3);
+        frontier.push(rest);
+        frontier.push(popped);
+        REQUIRE(frontier.size() == areas.size());
+        if (max_in_memory)
+            REQUIRE(frontier.num_spilled > 0);
+        else
+            REQUIRE(frontier.num_spilled == 0);
+
+        std::vector<mpq_class> got;
+        while (!frontier.empty()) {
+            for (Sofa *s : frontier.pop(7)) {
+                got.push_back(s->area());
+                REQUIRE(s->root_idx < 2);
+                delete s;
+            }
+        }
+        CAPTURE(max_in_memory);
+        REQUIRE(got == areas);
+        REQUIRE(frontier.num_restored == frontier.num_spilled);
+        REQUIRE(frontier.num_runs() == 0);
+    }
+}
+
+TEST_CASE( "Search with spilled sofas visits the same sofas", "[Frontier]" ) {
+    SearchConfig config = test::search_config(3, 5);
+
+    std::vector<unsigned long long> branched[2];
+    for (std::size_t max_in_memory : {0, 4}) {
+        config.max_in_memory = max_in_memory;
+        SearchStats stats;
+        auto sofas = run_search(
+                Sofa::a_priori_sofas(test::three_normals(), 1, 2),
+                27_mpq/10_mpz, 1, config, stats);
+        REQUIRE(sofas.empty());
+        REQUIRE(stats.closed_volume(2) == 1);
+        REQUIRE(stats.num_restored == stats.num_spilled);
+        if (max_in_memory)
+            REQUIRE(stats.num_spilled > 0);
+        branched[max_in_memory ? 1 : 0] = stats.branched_depths;
+    }
+    REQUIRE(branched[0] == branched[1]);
+
+    // a stopped search returns every open sofa
+    config.node_budget = 30;
+    SearchStats stats;
+    auto sofas = run_search(
+            Sofa::a_priori_sofas(test::three_normals(), 1, 2),
+            5_mpq/2_mpz, 1, config, stats);
+    REQUIRE(sofas.size() > 0);
+    for (std::size_t i = 1; i < sofas.size(); i++)
+        REQUIRE(!(sofas[i - 1]->area() < sofas[i]->area()));
+    mpq_class open_volume = 0;
+    for (Sofa *s : sofas) {
+        open_volume += mpq_class(1, 2) / (mpz_class(1) << s->depth);
+        delete s;
+    }
+    REQUIRE(open_volume + stats.closed_volume(2) == 1);
+}
+
+}; // namespace search
+}; // namespace sofa_designer
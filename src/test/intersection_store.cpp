@@ -0,0 +1,72 @@
+#include "catch.hpp"
+
+#include <vector>
+
+#include <gmp.h>
+#include <gmpxx.h>
+
+#include "intersection_store.hpp"
+
+namespace sofa_designer {
+namespace sofa {
+
+TEST_CASE( "IntersectionStore interns lines", "[IntersectionStore]" ) {
+    IntersectionStore store;
+    SharedLine l = store.line(Line(1_mpq/2_mpz, 3_mpq));
+    REQUIRE(*l == Line(1_mpq/2_mpz, 3_mpq));
+    // equal lines are the same pointer
+    REQUIRE(store.line(Line(2_mpq/4_mpz, 6_mpq/2_mpz)) == l);
+    REQUIRE(store.line(Line(1_mpq/2_mpz, 4_mpq)) != l);
+
+    SharedTableStats st = store.line_stats();
+    REQUIRE(st.num_hits == 1);
+    REQUIRE(st.num_misses == 2);
+}
+
+TEST_CASE( "IntersectionStore shares equal intersections", "[IntersectionStore]" ) {
+    IntersectionStore store;
+    SharedLine l0 = store.line(Line(1_mpq/2_mpz, 3_mpq));
+    SharedLine l1 = store.line(Line(-2_mpq, 1_mpq/7_mpz));
+    SharedLine l2 = store.line(Line(5_mpq, -1_mpq));
+
+    SharedCoord c01 = store.intersection(l0, l1);
+    REQUIRE(*c01 == geometry::intersection(*l0, *l1));
+    // in either order, and for lines interned again
+    REQUIRE(store.intersection(l1, l0) == c01);
+    REQUIRE(store.intersection(
+                store.line(Line(1_mpq/2_mpz, 3_mpq)), l1) == c01);
+
+    SharedCoord c02 = store.intersection(l0, l2);
+    REQUIRE(c02 != c01);
+    REQUIRE(*c02 == geometry::intersection(*l0, *l2));
+
+    SharedTableStats st = store.intersection_stats();
+    REQUIRE(st.num_hits == 2);
+    REQUIRE(st.num_misses == 2);
+    REQUIRE(st.num_entries == 2);
+}
+
+TEST_CASE( "IntersectionStore drops entries no longer held", "[IntersectionStore]" ) {
+    IntersectionStore store;
+    SharedLine base = store.line(Line(1_mpq, 0_mpq));
+    std::vector<SharedCoord> held;
+    // enough entries for every shard to be swept a few times
+    const int num = 100000;
+    for (int i = 0; i < num; i++) {
+        SharedCoord c = store.intersection(
+                base, store.line(Line(-1_mpq, mpq_class(i))));
+        if (i % 100 == 0)
+            held.push_back(c);
+    }
+    SharedTableStats st = store.intersection_stats();
+    REQUIRE(st.num_misses == num);
+    REQUIRE(st.num_entries < num / 2);
+    REQUIRE(store.line_stats().num_entries < num / 2);
+    // the held entries are still shared, and so are their lines
+    for (int i = 0; i < num; i += 100)
+        REQUIRE(store.intersection(
+                    base, store.line(Line(-1_mpq, mpq_class(i)))) == held[i / 100]);
+}
+
+}; // namespace sofa
+}; // namespace sofa_designer
@@ -0,0 +1,156 @@
+#include "catch.hpp"
+
+#include <memory>
+#include <vector>
+
+#include <gmp.h>
+#include <gmpxx.h>
+
+#include "policy.hpp"
+#include "search.hpp"
+
+namespace sofa_designer {
+namespace search {
+
+using sofa::Coord;
+
+static std::vector<Coord> five_normals()
+{
+    return {
+        Coord(24_mpq/25_mpz, 7_mpq/25_mpz),
+        Coord(56_mpq/65_mpz, 33_mpq/65_mpz),
+        Coord(120_mpq/169_mpz, 119_mpq/169_mpz),
+        Coord(33_mpq/65_mpz, 56_mpq/65_mpz),
+        Coord(7_mpq/25_mpz, 24_mpq/25_mpz),
+    };
+}
+
+// the sofa reached by always branching greedily into the larger child
+static Sofa *descend(std::size_t depth)
+{
+    auto sofas = Sofa::a_priori_sofas(five_normals(), 2, 1);
+    Sofa *s = sofas[0];
+    for (std::size_t d = 0; d < depth; d++) {
+        Sofa *s1, *s2;
+        std::tie(s1, s2) = branch(s, 2);
+        delete s;
+        if (s1->area() < s2->area())
+            std::swap(s1, s2);
+        delete s2;
+        s = s1;
+    }
+    return s;
+}
+
+TEST_CASE( "Choice codes", "[Policy]" ) {
+    for (std::size_t code = 0; code < 10; code++)
+        REQUIRE(BranchChoice::from_code(code).code() == code);
+    BranchChoice c = {3, true};
+    REQUIRE(c.down() == sofa::kMuDown);
+    REQUIRE(c.up() == sofa::kMuUp);
+    c.is_mu = false;
+    REQUIRE(c.down() == sofa::kNuDown);
+    REQUIRE(c.up() == sofa::kNuUp);
+}
+
+TEST_CASE( "Greedy and max-min policies maximize their scores", "[Policy]" ) {
+    for (std::size_t depth : {0, 6}) {
+        Sofa *s = descend(depth);
+        BranchConfig exact;
+        exact.num_exact = 0;
+
+        mpq_class gain;
+        BranchChoice g = GreedyPolicy().choose(*s, gain);
+        BranchChoice m = MaxMinPolicy(BranchConfig(), 0).choose(*s);
+        mpq_class max_gain = 0, max_min = 0;
+        for (std::size_t i = 0; i < s->n; i++)
+            for (bool is_mu : {true, false}) {
+                if (is_mu && i == s->mu_fix_idx)
+                    continue;
+                BranchChoice c = {i, is_mu};
+                mpq_class gd = s->calc_halve_gain(i, c.down());
+                mpq_class gu = s->calc_halve_gain(i, c.up());
+                max_gain = std::max(max_gain, std::max(gd, gu));
+                max_min = std::max(max_min, std::min(gd, gu));
+            }
+        CAPTURE(depth);
+        REQUIRE(gain == max_gain);
+        REQUIRE(std::max(s->halve_gain(g.idx, g.down()),
+                    s->halve_gain(g.idx, g.up())) == max_gain);
+        if (max_min > 0)
+            REQUIRE(std::min(s->halve_gain(m.idx, m.down()),
+                        s->halve_gain(m.idx, m.up())) == max_min);
+
+        BranchChoice ge = GreedyPolicy(exact).choose(*s);
+        REQUIRE(ge.code() == g.code());
+        delete s;
+    }
+}
+
+TEST_CASE( "Lookahead is greedy below its depth", "[Policy]" ) {
+    Sofa *s = descend(3);
+    LookaheadPolicy shallow(BranchConfig(), 3, 4);
+    REQUIRE(shallow.choose(*s).code() == GreedyPolicy().choose(*s).code());
+
+    LookaheadPolicy deep(BranchConfig(), 8, 4);
+    BranchChoice c = deep.choose(*s);
+    REQUIRE(c.idx < s->n);
+    REQUIRE(!(c.is_mu && c.idx == s->mu_fix_idx));
+    REQUIRE(std::max(s->halve_gain(c.idx, c.down()),
+                s->halve_gain(c.idx, c.up())) > 0);
+    delete s;
+}
+
+TEST_CASE( "Recorded policy replays the most frequent choice", "[Policy]" ) {
+    std::vector< std::vector<unsigned long long> > choice_depths(2);
+    // depth 0: nu of 1 twice, mu of 0 once
+    choice_depths[0] = {1, 0, 0, 2};
+    std::shared_ptr<const BranchingPolicy> greedy =
+        std::make_shared<GreedyPolicy>();
+    RecordedPolicy policy(choice_depths, greedy);
+    REQUIRE(policy.num_recorded() == 1);
+
+    Sofa *s = descend(0);
+    BranchChoice c = policy.choose(*s);
+    REQUIRE(c.idx == 1);
+    REQUIRE(!c.is_mu);
+    delete s;
+
+    // nothing recorded at depth 1
+    s = descend(1);
+    REQUIRE(policy.choose(*s).code() == greedy->choose(*s).code());
+    delete s;
+}
+
+TEST_CASE( "Search records the choices and closes with every policy", "[Policy]" ) {
+    std::vector< std::shared_ptr<const BranchingPolicy> > policies = {
+        std::make_shared<GreedyPolicy>(),
+        std::make_shared<MaxMinPolicy>(),
+        std::make_shared<LookaheadPolicy>(BranchConfig(), 2, 2),
+    };
+    for (const auto &policy : policies) {
+        SearchConfig config;
+        config.num_threads = 2;
+        config.num_iter_per_batch = 20;
+        config.print_progress = false;
+        config.policy = policy;
+        SearchStats stats;
+        auto sofas = run_search(
+                Sofa::a_priori_sofas(five_normals(), 2, 1),
+                27_mpq/10_mpz, 2, config, stats);
+        REQUIRE(sofas.empty());
+        REQUIRE(stats.closed_volume(1) == 1);
+
+        // one choice per branched sofa
+        REQUIRE(stats.choice_depths.size() == stats.branched_depths.size());
+        for (std::size_t d = 0; d < stats.choice_depths.size(); d++) {
+            unsigned long long num = 0;
+            for (auto c : stats.choice_depths[d])
+                num += c;
+            REQUIRE(num == stats.branched_depths[d]);
+        }
+    }
+}
+
+}; // namespace search
+}; // namespace sofa_designer
@@ -0,0 +1,48 @@
+#include "catch.hpp"
+
+#include <sstream>
+
+#include "profile.hpp"
+
+namespace sofa_designer {
+namespace profile {
+
+TEST_CASE( "Merging and printing profile counters", "[Profile]" ) {
+    Counters a, b;
+    a.ticks[kHalveGain] = 10;
+    a.calls[kHalveGain] = 1;
+    b.ticks[kHalveGain] = 5;
+    b.calls[kHalveGain] = 2;
+    b.counts[kArrangementExact] = 7;
+    a.merge(b);
+    REQUIRE(a.ticks[kHalveGain] == 15);
+    REQUIRE(a.calls[kHalveGain] == 3);
+    REQUIRE(a.counts[kArrangementExact] == 7);
+    REQUIRE(a.counts[kArrangementCached] == 0);
+
+    std::ostringstream json;
+    print_json(json, a, 1.0, 42);
+    REQUIRE(json.str().find("\"arrangement_exact\":7") != std::string::npos);
+    REQUIRE(json.str().find("\"iter\":42") != std::string::npos);
+    REQUIRE(json.str().back() == '\n');
+
+    a.clear();
+    REQUIRE(a.calls[kHalveGain] == 0);
+}
+
+TEST_CASE( "Scoped timers count calls when profiling", "[Profile]" ) {
+    thread_counters().clear();
+    {
+        SOFA_PROFILE_SCOPE(kCalcArea);
+        SOFA_PROFILE_COUNT(kArrangementCached);
+    }
+    if (kEnabled) {
+        REQUIRE(thread_counters().calls[kCalcArea] == 1);
+        REQUIRE(thread_counters().counts[kArrangementCached] == 1);
+    } else {
+        REQUIRE(thread_counters().calls[kCalcArea] == 0);
+    }
+}
+
+}; // namespace profile
+}; // namespace sofa_designer
@@ -0,0 +1,84 @@
+#include "catch.hpp"
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "progress.hpp"
+
+namespace sofa_designer {
+namespace search {
+
+TEST_CASE( "Snapshots sum the metrics of workers", "[ProgressReporter]" ) {
+    std::ostringstream out;
+    ProgressReporter reporter(3, 2, 0, out);
+
+    WorkerMetrics::add(reporter.worker(0).num_iter, 10ULL);
+    WorkerMetrics::add(reporter.worker(2).num_iter, 5ULL);
+    WorkerMetrics::add(reporter.worker(1).root_closed_volume[0], 0.25);
+    WorkerMetrics::add(reporter.worker(2).root_closed_volume[0], 0.25);
+    WorkerMetrics::add(reporter.worker(2).root_closed_volume[1], 0.5);
+    reporter.worker(0).stack_size = 2;
+    reporter.worker(0).min_area = 2.0;
+    reporter.worker(0).max_area = 3.0;
+    reporter.worker(1).stack_size = 1;
+    reporter.worker(1).min_area = 1.5;
+    reporter.worker(1).max_area = 1.5;
+    // an empty stack does not count towards the areas
+    reporter.worker(2).min_area = 0.1;
+
+    ProgressSnapshot snap = reporter.snapshot();
+    REQUIRE(snap.num_iter == 15);
+    REQUIRE(snap.stack_size == 3);
+    REQUIRE(snap.min_area == 1.5);
+    REQUIRE(snap.max_area == 3.0);
+    REQUIRE(snap.root_closed_volume == std::vector<double>({0.5, 0.5}));
+    REQUIRE(snap.closed_volume == 0.5);
+
+    snap.elapsed = 10;
+    REQUIRE(snap.eta() == 10);
+    snap.closed_volume = 0;
+    REQUIRE(snap.eta() < 0);
+
+    // a reporter with no interval writes nothing
+    reporter.stop();
+    REQUIRE(out.str().empty());
+}
+
+TEST_CASE( "Reporter writes a line when stopped", "[ProgressReporter]" ) {
+    std::ostringstream out;
+    {
+        ProgressReporter reporter(1, 1, 3600, out);
+        WorkerMetrics::add(reporter.worker(0).num_iter, 7ULL);
+    }
+    REQUIRE(out.str().find("\"iter\":7") != std::string::npos);
+    REQUIRE(out.str().back() == '\n');
+}
+
+TEST_CASE( "Lines written beside the reporter do not interleave", "[ProgressReporter]" ) {
+    std::ostringstream out;
+    {
+        ProgressReporter reporter(1, 1, 1e-4, out);
+        std::thread writer([&]{
+                for (int i = 0; i < 200; i++)
+                    reporter.write("Batch #" + std::to_string(i) + "\n");
+                });
+        writer.join();
+    }
+    std::istringstream in(out.str());
+    std::size_t num_batches = 0;
+    for (std::string line; std::getline(in, line); ) {
+        CAPTURE(line);
+        if (line.compare(0, 6, "Batch ") == 0) {
+            REQUIRE(line.find('{') == std::string::npos);
+            num_batches++;
+        } else {
+            REQUIRE(line.compare(0, 12, "{\"progress\":") == 0);
+            REQUIRE(line.compare(line.size() - 3, 3, "]}}") == 0);
+        }
+    }
+    REQUIRE(num_batches == 200);
+}
+
+}; // namespace search
+}; // namespace sofa_designer
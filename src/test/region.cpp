@@ -34,7 +34,7 @@ void sort_polygons(Polygons &polys)
         sort_polygon(poly);
     }
 
-    sort(polys.begin(), polys.end());
+    std::sort(polys.begin(), polys.end());
 }
 
 void check_eq(Polygon p0, Polygon p1)
@@ -112,7 +112,7 @@ TEST_CASE( "Initialize and run a HalfPlaneRegion", "[VanillaLineContext][HalfPla
     CAPTURE(lines);
 
     VanillaLineContext ctx(lines);
-    std::vector<LineId> line_ids(lines.size());
+    Polygon line_ids(lines.size());
     for (std::size_t i = 0; i < lines.size(); i++) {
         const Line &l = lines[i];
         int id = 0;
@@ -130,7 +130,7 @@ TEST_CASE( "Initialize and run a HalfPlaneRegion", "[VanillaLineContext][HalfPla
     }
     INFO("Converting lines to id's");
     CAPTURE(line_ids);
-    std::vector<LineId> expected_line_ids = { 
+    Polygon expected_line_ids = { 
         1, 5, 2, 0, 6, 
         ~short(4), ~short(5), ~short(3), ~short(0), ~short(7)
     };
@@ -139,7 +139,7 @@ TEST_CASE( "Initialize and run a HalfPlaneRegion", "[VanillaLineContext][HalfPla
     INFO("Setup done");
 
     INFO("Initialize HalfPlaneRegions");
-    HalfPlaneRegion r5(ctx, 5);
+    HalfPlaneRegion<VanillaLineContext> r5(ctx, 5);
 
     /*
 
@@ -188,18 +188,39 @@ TEST_CASE( "Initialize and run a HalfPlaneRegion", "[VanillaLineContext][HalfPla
     // Found couple bugs using this
     // This test have two polygons cut out, and one edge of polygon
     // is aligned to the cutting line
-    HalfPlaneRegion rn2(ctx, ~short(2));
+    HalfPlaneRegion<VanillaLineContext> rn2(ctx, ~short(2));
     check_eq(rn2.intersection(line_ids), {
         {~short(2), ~short(7), 1, 5},
         {0, 6, ~short(2)}
     });
 
-    HalfPlaneRegion r3(ctx, 3);
+    HalfPlaneRegion<VanillaLineContext> r3(ctx, 3);
     check_eq(r3.intersection(line_ids), {
         {~short(0), ~short(7), 3},
         {3, 6, ~short(4), ~short(5)}
     });
 
+    // clipping into a reused buffer gives the same polygons
+    Polygons out;
+    rn2.intersection(Polygons{line_ids}, out);
+    check_eq(out, rn2.intersection(line_ids));
+    r5.intersection(Polygons{line_ids}, out);
+    check_eq(out, {
+        {5, ~short(3), ~short(0), ~short(7), 1},
+    });
+    // and the single polygon version appends
+    r3.intersection(line_ids, out);
+    REQUIRE(out.size() == 3);
+
+    // a sequence clips by each region in turn
+    RegionSequence<VanillaLineContext> seq(ctx);
+    seq.add_half_plane(~short(2));
+    seq.add_half_plane(3);
+    check_eq(seq.intersection(Polygons{line_ids}), 
+            r3.intersection(rn2.intersection(line_ids)));
+    seq.add_half_plane(~short(3));
+    REQUIRE(seq.intersection(Polygons{line_ids}).empty());
+
     // TODO: generate a large testcase using GeoGebra and Mathematica.
 }
 
@@ -245,7 +266,7 @@ TEST_CASE(
     CAPTURE(lines);
 
     VanillaLineContext ctx(lines);
-    std::vector<LineId> line_ids(lines.size());
+    Polygon line_ids(lines.size());
     for (std::size_t i = 0; i < lines.size(); i++) {
         const Line &l = lines[i];
         int id = 0;
@@ -263,7 +284,7 @@ TEST_CASE(
     }
     INFO("Converting lines to id's");
     CAPTURE(line_ids);
-    std::vector<LineId> expected_line_ids = { 
+    Polygon expected_line_ids = { 
         1, 5, 2, 0, 6, 
         ~short(4), ~short(5), ~short(3), ~short(0), ~short(7)
     };
@@ -292,16 +313,16 @@ TEST_CASE(
 
      */
 
-    UnionOfTwoHalfPlanesRegion r50(ctx, 5, 0);
+    UnionOfTwoHalfPlanesRegion<VanillaLineContext> r50(ctx, 5, 0);
     check_eq(r50.intersection(line_ids), {
         {1, 5, 0, 6, ~4, ~5, ~3, ~0, ~7}
     });
-    UnionOfTwoHalfPlanesRegion r3n5(ctx, 3, ~5);
+    UnionOfTwoHalfPlanesRegion<VanillaLineContext> r3n5(ctx, 3, ~5);
     check_eq(r3n5.intersection(line_ids), {
         {~0, ~7, 3},
         {2, 0, 6, ~4, ~5}
     });
-    UnionOfTwoHalfPlanesRegion rn03(ctx, ~0, 3);
+    UnionOfTwoHalfPlanesRegion<VanillaLineContext> rn03(ctx, ~0, 3);
     check_eq(rn03.intersection(line_ids), {
         {3, 6, ~4, ~5},
         {~0, ~7, 1, 5, 2}
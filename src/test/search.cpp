@@ -0,0 +1,200 @@
+#include "catch.hpp"
+
+#include <tuple>
+#include <vector>
+
+#include <gmp.h>
+#include <gmpxx.h>
+
+#include "search.hpp"
+#include "fixtures.hpp"
+
+namespace sofa_designer {
+namespace search {
+
+using sofa::Coord;
+using sofa::HalveGainCache;
+using sofa::SofaRecord;
+using test::three_normals;
+
+bool same_box(const Sofa &a, const Sofa &b)
+{
+    for (std::size_t i = 0; i < a.n; i++) {
+        if (a.mu_range[i].min != b.mu_range[i].min ||
+                a.mu_range[i].max != b.mu_range[i].max ||
+                a.nu_range[i].min != b.nu_range[i].min ||
+                a.nu_range[i].max != b.nu_range[i].max)
+            return false;
+    }
+    return true;
+}
+
+TEST_CASE( "Screened branching picks the best exact gain", "[Search]" ) {
+    auto sofas = Sofa::a_priori_sofas(three_normals(), 1, 2);
+    BranchConfig exact;
+    exact.num_exact = 0;
+    Sofa *s = sofas[0];
+    for (int depth = 0; depth < 12; depth++) {
+        Sofa *e1, *e2, *a1, *a2;
+        std::tie(e1, e2) = branch(s, 1, exact);
+        std::tie(a1, a2) = branch(s, 1);
+        REQUIRE(same_box(*e1, *a1));
+        REQUIRE(e1->area() == a1->area());
+        REQUIRE(e2->area() == a2->area());
+        delete a1;
+        delete a2;
+        delete s;
+        if (e1->area() < e2->area())
+            std::swap(e1, e2);
+        delete e2;
+        s = e1;
+    }
+    delete s;
+    delete sofas[1];
+}
+
+TEST_CASE( "A wrong inherited gain only misleads the choice", "[Search]" ) {
+    auto sofas = Sofa::a_priori_sofas(three_normals(), 1, 2);
+    delete sofas[1];
+    Sofa *p = sofas[0];
+    Sofa *s = new Sofa(*p, 0, sofa::kNuUp);
+    delete p;
+    // a cut that slipped past the floating-point test of inherit_gains
+    // leaves an inherited gain that is not the one of s
+    BranchChoice choice = BranchChoice::from_code(0);
+    for (HalveType t : {choice.down(), choice.up()}) {
+        HalveGainCache &g = s->gains[4*choice.idx + t];
+        g.exact = s->calc_halve_gain(choice.idx, t) + 1_mpq/1000_mpz;
+        g.exact_known = g.inherited = true;
+    }
+
+    // the children neither take their area from it nor abort
+    Sofa *sd, *su;
+    std::tie(sd, su) = branch(s, choice);
+    for (auto c : {std::make_pair(sd, choice.down()), 
+            std::make_pair(su, choice.up())}) {
+        REQUIRE(s->halve_gain(choice.idx, c.second) != 
+                s->calc_halve_gain(choice.idx, c.second));
+        REQUIRE(c.first->area() + s->calc_halve_gain(choice.idx, c.second) == 
+                s->area());
+        double est, err;
+        REQUIRE(!s->estimate_child_area(choice.idx, c.second, est, err));
+        delete c.first;
+    }
+    delete s;
+}
+
+TEST_CASE( "Search closes every sofa for an easy target", "[Search]" ) {
+    SearchConfig config = test::search_config(2, 10);
+    SearchStats stats;
+
+    auto sofas = run_search(
+            Sofa::a_priori_sofas(three_normals(), 1, 2),
+            27_mpq/10_mpz, 1, config, stats);
+    REQUIRE(sofas.empty());
+    REQUIRE(stats.num_iter > 0);
+    REQUIRE(stats.num_batches > 1);
+
+    // every branched sofa has two children,
+    // and every sofa is either branched or closed
+    unsigned long long num_branched = 0, num_closed = 0;
+    for (auto c : stats.branched_depths)
+        num_branched += c;
+    for (auto c : stats.closed_depths)
+        num_closed += c;
+    REQUIRE(num_closed == num_branched + 2);
+
+    // the closed boxes cover each initial sofa
+    REQUIRE(stats.root_closed_volume(0) == 1);
+    REQUIRE(stats.root_closed_volume(1) == 1);
+    REQUIRE(stats.closed_volume(2) == 1);
+}
+
+TEST_CASE( "Search records the closed sofas it does not build", "[Search]" ) {
+    SearchConfig config = test::search_config(1, 10);
+    config.keep_closed = true;
+    SearchStats stats;
+
+    std::vector<Coord> normals = three_normals();
+    mpq_class target = 27_mpq/10_mpz;
+    auto sofas = run_search(
+            Sofa::a_priori_sofas(normals, 1, 2), target, 1, config, stats);
+    REQUIRE(sofas.empty());
+    unsigned long long num_closed = 0;
+    for (auto c : stats.closed_depths)
+        num_closed += c;
+    REQUIRE(stats.closed_sofas.size() == num_closed);
+
+    // closed children are left unbuilt when a gain their parent 
+    // computed decides them, and their records are still exact
+    for (const SofaRecord &r : stats.closed_sofas) {
+        REQUIRE(r.area < target);
+        Sofa *s = Sofa::from_record(normals, 1, r);
+        REQUIRE(s->area() == r.area);
+        delete s;
+    }
+}
+
+TEST_CASE( "Search with multi-level splits closes every sofa", "[Search]" ) {
+    for (std::size_t min_depth : {0, 3}) {
+        SearchConfig config = test::search_config(2, 10);
+        config.split_levels = 3;
+        config.split_min_depth = min_depth;
+        SearchStats stats;
+
+        auto sofas = run_search(
+                Sofa::a_priori_sofas(three_normals(), 1, 2),
+                27_mpq/10_mpz, 1, config, stats);
+        REQUIRE(sofas.empty());
+
+        // every halving still counts as a branched sofa
+        unsigned long long num_branched = 0, num_closed = 0;
+        for (auto c : stats.branched_depths)
+            num_branched += c;
+        for (auto c : stats.closed_depths)
+            num_closed += c;
+        REQUIRE(num_closed == num_branched + 2);
+        REQUIRE(stats.num_iter < num_branched);
+        REQUIRE(stats.closed_volume(2) == 1);
+    }
+}
+
+TEST_CASE( "Search aborts when the estimated time left is too long", "[Search]" ) {
+    SearchConfig config = test::search_config(1, 5);
+    config.abort_after = 0;
+    config.abort_eta = 1e-9;
+    SearchStats stats;
+
+    auto sofas = run_search(
+            Sofa::a_priori_sofas(three_normals(), 1, 2),
+            5_mpq/2_mpz, 1, config, stats);
+    REQUIRE(stats.aborted);
+    REQUIRE(sofas.size() > 0);
+    REQUIRE(stats.closed_volume(2) < 1);
+    for (auto s : sofas)
+        delete s;
+}
+
+TEST_CASE( "Search stops at the node budget", "[Search]" ) {
+    SearchConfig config = test::search_config(3, 7);
+    config.node_budget = 40;
+
+    std::vector<unsigned long long> branched[2];
+    for (int run = 0; run < 2; run++) {
+        SearchStats stats;
+        auto sofas = run_search(
+                Sofa::a_priori_sofas(three_normals(), 1, 2),
+                5_mpq/2_mpz, 1, config, stats);
+        REQUIRE(stats.num_iter <= 40);
+        REQUIRE(stats.num_iter >= 40 - config.num_threads);
+        REQUIRE(sofas.size() > 0);
+        for (auto s : sofas)
+            delete s;
+        branched[run] = stats.branched_depths;
+    }
+    // the sofas visited do not depend on timing
+    REQUIRE(branched[0] == branched[1]);
+}
+
+}; // namespace search
+}; // namespace sofa_designer
@@ -0,0 +1,79 @@
+#include "catch.hpp"
+
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "small_vector.hpp"
+
+namespace sofa_designer {
+
+TEST_CASE("SmallVector stays inline up to its capacity", "[SmallVector]") {
+    SmallVector<int, 4> v;
+    for (int i = 0; i < 4; i++)
+        v.push_back(i);
+    REQUIRE(!v.is_spilled());
+    REQUIRE(v.capacity() == 4);
+
+    v.push_back(4);
+    REQUIRE(v.is_spilled());
+    REQUIRE(v.size() == 5);
+    for (int i = 0; i < 5; i++)
+        REQUIRE(v[i] == i);
+
+    v.pop_back();
+    v.erase(v.begin() + 1, v.begin() + 3);
+    REQUIRE(v == SmallVector<int, 4>({0, 3}));
+}
+
+TEST_CASE("SmallVector copies and moves", "[SmallVector]") {
+    typedef SmallVector<std::string, 2> Strings;
+    Strings small{"a", "b"};
+    Strings large{"a", "b", "c"};
+
+    for (const Strings &orig : {small, large}) {
+        Strings copied(orig);
+        REQUIRE(copied == orig);
+
+        Strings moved(std::move(copied));
+        REQUIRE(moved == orig);
+        REQUIRE(moved.is_spilled() == (orig.size() > 2));
+
+        Strings assigned{"x"};
+        assigned = orig;
+        REQUIRE(assigned == orig);
+        assigned = std::move(moved);
+        REQUIRE(assigned == orig);
+    }
+
+    // nested vectors as in Polygons
+    SmallVector<SmallVector<int, 3>, 1> nested;
+    nested.push_back({1, 2, 3, 4});
+    nested.push_back({5});
+    auto nested_copy = nested;
+    REQUIRE(nested_copy.size() == 2);
+    REQUIRE(nested_copy[0] == SmallVector<int, 3>({1, 2, 3, 4}));
+    REQUIRE(nested_copy[1] == SmallVector<int, 3>({5}));
+}
+
+TEST_CASE("SmallVector inserts ranges", "[SmallVector]") {
+    SmallVector<int, 4> v{0, 5};
+    std::vector<int> mid{1, 2, 3, 4};
+    v.insert(v.begin() + 1, mid.begin(), mid.end());
+    REQUIRE(v == SmallVector<int, 4>({0, 1, 2, 3, 4, 5}));
+
+    // input iterators through a non-random access range
+    std::list<int> tail{6, 7};
+    v.insert(v.end(), tail.begin(), tail.end());
+    REQUIRE(v.size() == 8);
+    REQUIRE(v.back() == 7);
+
+    v.resize(2);
+    REQUIRE(v == SmallVector<int, 4>({0, 1}));
+    REQUIRE(v < SmallVector<int, 4>({0, 2}));
+    v.clear();
+    REQUIRE(v.empty());
+}
+
+}; // namespace sofa_designer
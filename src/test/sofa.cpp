@@ -1,6 +1,7 @@
 #include "catch.hpp"
 
 #include <algorithm>
+#include <cmath>
 #include <random>
 #include <vector>
 #include <iostream>
@@ -9,6 +10,7 @@
 #include <gmpxx.h>
 
 #include "sofa.hpp"
+#include "fixtures.hpp"
 
 namespace sofa_designer {
 namespace sofa {
@@ -63,12 +65,26 @@ TEST_CASE( "Basic functionality of Sofa", "[Sofa]" ) {
             }
             };
     REQUIRE(s.coord_polygons() == coord_ans);
+    REQUIRE(s.depth == 0);
     Sofa s2(s, 3, HalveType::kNuUp);
+    REQUIRE(s2.depth == 1);
     CAPTURE(s2.polygons);
     CAPTURE(s2.coord_polygons());
-    REQUIRE(s2.area + s.halve_gain(3, kNuUp) == s.area);
+    REQUIRE(s2.area() + s.halve_gain(3, kNuUp) == s.area());
     Sofa s3(s2, 1, HalveType::kMuDown);
-    REQUIRE(s3.area + s2.halve_gain(1, kMuDown) == s2.area);
+    REQUIRE(s3.area() + s2.halve_gain(1, kMuDown) == s2.area());
+
+    ApproxPolygons approx = s3.approx_polygons();
+    REQUIRE(approx_area(approx) == Approx(s3.area().get_d()));
+    for (std::size_t i = 0; i < s3.n; i++)
+        for (auto t : {kMuDown, kMuUp, kNuDown, kNuUp}) {
+            if (i == mu_fix_idx && Sofa::is_mu(t))
+                continue;
+            CAPTURE(i);
+            CAPTURE(t);
+            REQUIRE(s3.approx_halve_gain(approx, i, t) == 
+                    Approx(s3.halve_gain(i, t).get_d()).margin(1e-12));
+        }
 }
 
 TEST_CASE( "Initial sofa list", "[Sofa]" ) {
@@ -86,10 +102,118 @@ TEST_CASE( "Initial sofa list", "[Sofa]" ) {
     auto sofas = Sofa::a_priori_sofas(
             normals, 2, 3);
     CAPTURE(sofas[1]->coord_polygons());
+    for (std::size_t i = 0; i < sofas.size(); i++) {
+        REQUIRE(sofas[i]->root_idx == i);
+        REQUIRE(Sofa(*sofas[i], 0, kNuUp).root_idx == i);
+    }
     // REQUIRE(false);
     for (auto p : sofas)
         delete p;
 }
 
+TEST_CASE( "Gains inherited by children match the exact ones", "[Sofa]" ) {
+    std::vector<mpq_class> x = 
+    {
+        24_mpq/25_mpz,56_mpq/65_mpz,120_mpq/169_mpz,33_mpq/65_mpz,7_mpq/25_mpz
+    };
+    std::vector<mpq_class> y = 
+    {
+        7_mpq/25_mpz,33_mpq/65_mpz,119_mpq/169_mpz,56_mpq/65_mpz,24_mpq/25_mpz
+    };
+    std::vector<Coord> normals(x.size());
+    for (std::size_t i = 0; i < x.size(); i++)
+        normals[i] = Coord(x[i], y[i]);
+    auto sofas = Sofa::a_priori_sofas(normals, 2, 1);
+    Sofa *s = sofas[0];
+    std::size_t num_kept = 0;
+    for (std::size_t depth = 0; depth < 10; depth++) {
+        ApproxPolygons approx = s->approx_polygons();
+        for (std::size_t i = 0; i < s->n; i++)
+            for (auto t : {kMuDown, kMuUp, kNuDown, kNuUp}) {
+                if (i == s->mu_fix_idx && Sofa::is_mu(t))
+                    continue;
+                s->halve_gain(i, t);
+                s->approx_halve_gain(approx, i, t);
+            }
+        std::size_t idx = (depth * 3) % s->n;
+        HalveType t = (depth % 2 ? kNuDown : kNuUp);
+        Sofa *c = new Sofa(*s, idx, t);
+        for (std::size_t i = 0; i < c->n; i++)
+            for (auto u : {kMuDown, kMuUp, kNuDown, kNuUp}) {
+                const HalveGainCache &g = c->gains[4*i + u];
+                REQUIRE(g.exact_known == g.approx_known);
+                if (!g.exact_known)
+                    continue;
+                CAPTURE(depth);
+                CAPTURE(i);
+                CAPTURE(u);
+                REQUIRE(i != idx);
+                REQUIRE(g.inherited);
+                REQUIRE(!g.computed());
+                // no area is derived from an inherited gain
+                double est, err;
+                REQUIRE(!c->estimate_child_area(i, u, est, err));
+                REQUIRE(g.exact == c->calc_halve_gain(i, u));
+                num_kept++;
+            }
+        delete s;
+        s = c;
+    }
+    REQUIRE(num_kept > 0);
+
+    // rebuilding from the box gives the same sofa
+    Sofa *r = Sofa::from_record(normals, 2, s->record());
+    REQUIRE(r->area() == s->area());
+    REQUIRE(r->depth == 10);
+    REQUIRE(r->root_idx == s->root_idx);
+    for (std::size_t i = 0; i < s->n; i++) {
+        REQUIRE(r->mu_range[i].min == s->mu_range[i].min);
+        REQUIRE(r->nu_range[i].max == s->nu_range[i].max);
+    }
+    delete r;
+    delete s;
+}
+
+TEST_CASE( "Area estimates bound the exact area", "[Sofa]" ) {
+    std::vector<Coord> normals = test::three_normals();
+    auto sofas = Sofa::a_priori_sofas(normals, 1, 2);
+    Sofa *s = sofas[0];
+    delete sofas[1];
+    for (std::size_t depth = 0; depth < 12; depth++) {
+        std::size_t idx = (depth * 2) % s->n;
+        HalveType t = (depth % 2 ? kNuDown : kNuUp);
+        // the area of the first child is taken from the parent,
+        // exactly or as an estimate, and the one of the second child 
+        // is estimated from its vertices
+        s->halve_gain(idx, t);
+        double est, err;
+        REQUIRE(s->estimate_child_area(idx, t, est, err));
+        Sofa *c[2] = {new Sofa(*s, idx, t), 
+            new Sofa(*s, idx, HalveType(t ^ 1))};
+        REQUIRE(std::abs(est - c[0]->calc_area(c[0]->polygons).get_d()) <= err);
+        for (Sofa *cs : c) {
+            CAPTURE(depth);
+            // an area taken from the parent is the one of the polygons
+            mpq_class exact = cs->calc_area(cs->polygons);
+            REQUIRE(cs->area_error >= 0);
+            REQUIRE(std::abs(cs->area_estimate - exact.get_d()) <= 
+                    cs->area_error);
+            // decided by the estimate or not, as the exact comparison,
+            // on a copy so that the area of cs is still not computed
+            Sofa copy(*cs);
+            mpq_class eps = 1_mpq/1000000_mpz;
+            for (const mpq_class &target : std::vector<mpq_class>{
+                    exact, exact + eps, exact - eps, exact + 1})
+                REQUIRE(copy.area_below(target) == (exact < target));
+            REQUIRE(copy.area() == exact);
+        }
+        // alternate between parents of known and estimated area
+        delete s;
+        delete c[1 - depth % 2];
+        s = c[depth % 2];
+    }
+    delete s;
+}
+
 }; // namespace geometry
 }; // namespace sofa_designer
@@ -113,6 +113,26 @@ TEST_CASE( "Basic functionality of SofaLineContext", "[SofaLineContext]" ) {
     test_ctx(ctx4, 0.2);
 }
 
+TEST_CASE( "Arrangements of nearly concurrent lines", "[SofaLineContext]" ) {
+    // the lines of intercept -1 pass through (0, -1), up to eps
+    // below which the double filter cannot tell the arrangement
+    mpq_class eps("1/1000000000000000000000000");
+    for (mpq_class d : {mpq_class(0), eps, mpq_class(-eps)}) {
+        std::vector<BandPair> bps = {
+            BandPair(mpq_class(-1, 3), -1, 0, 1, 2),
+            BandPair(0, -1 + d, 0, 1, 2),
+            BandPair(mpq_class(7, 5), -1, 0, 1, 2),
+        };
+        SofaLineContext ctx(bps);
+        auto lines = ctx.all_lines();
+        CAPTURE(d);
+        REQUIRE(ctx.arrangement(0, 4, 8) == 
+                geometry::arrangement(lines[0], lines[4], lines[8]));
+        REQUIRE(ctx.arrangement(0, 4, 8) == (d <= 0 ? kV : kU));
+        test_ctx(ctx);
+    }
+}
+
 TEST_CASE( "Automated stress test on SofaLineContext", "[SofaLineContext]" ) {
     std::vector<mpq_class> slopes;
     mpq_class s_min = -5_mpq, s_max = +6_mpq;
@@ -0,0 +1,64 @@
+#include "catch.hpp"
+
+#include <vector>
+
+#include <gmp.h>
+#include <gmpxx.h>
+
+#include "sofa_pool.hpp"
+#include "fixtures.hpp"
+
+namespace sofa_designer {
+namespace sofa {
+
+static void require_same(Sofa &a, Sofa &b)
+{
+    REQUIRE(a.depth == b.depth);
+    REQUIRE(a.root_idx == b.root_idx);
+    for (std::size_t i = 0; i < a.n; i++) {
+        REQUIRE(a.mu_range[i].min == b.mu_range[i].min);
+        REQUIRE(a.mu_range[i].max == b.mu_range[i].max);
+        REQUIRE(a.nu_range[i].min == b.nu_range[i].min);
+        REQUIRE(a.nu_range[i].max == b.nu_range[i].max);
+    }
+    REQUIRE(a.ctx.all_lines() == b.ctx.all_lines());
+    REQUIRE(a.coord_polygons() == b.coord_polygons());
+    REQUIRE(a.area() == b.area());
+    for (std::size_t k = 0; k < a.gains.size(); k++) {
+        REQUIRE(a.gains[k].exact_known == b.gains[k].exact_known);
+        if (a.gains[k].exact_known)
+            REQUIRE(a.gains[k].exact == b.gains[k].exact);
+    }
+}
+
+TEST_CASE( "SofaPool builds children in recycled sofas", "[SofaPool]" ) {
+    std::vector<Coord> normals = test::three_normals();
+    auto sofas = Sofa::a_priori_sofas(normals, 1, 2);
+    delete sofas[1];
+    Sofa *s = sofas[0];
+
+    SofaPool pool(2);
+    for (std::size_t depth = 0; depth < 12; depth++) {
+        std::size_t idx = (depth * 2) % s->n;
+        HalveType t = (depth % 2 ? kNuDown : kMuUp);
+        if (idx == s->mu_fix_idx)
+            t = kNuUp;
+        s->halve_gain(idx, t);
+        Sofa *c = pool.child(*s, idx, t);
+        Sofa fresh(*s, idx, t);
+        CAPTURE(depth);
+        require_same(*c, fresh);
+        // the other child goes back to the pool right away
+        pool.recycle(pool.child(*s, idx, HalveType(t ^ 1)));
+        pool.recycle(s);
+        s = c;
+    }
+    delete s;
+
+    SofaPool::Stats st = pool.stats();
+    REQUIRE(st.num_allocated + st.num_reused == 24);
+    REQUIRE(st.num_reused >= 20);
+}
+
+}; // namespace sofa
+}; // namespace sofa_designer
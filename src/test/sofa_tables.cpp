@@ -0,0 +1,75 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "sofa_tables.hpp"
+
+namespace sofa_designer {
+namespace sofa {
+
+TEST_CASE( "SofaTables index pairs and triples of lines", "[SofaTables]" ) {
+    for (std::size_t n : {3, 5, 11}) {
+        const SofaTables &t = SofaTables::get(n);
+        REQUIRE(t.n() == n);
+        REQUIRE(&SofaTables::get(n) == &t);
+        std::size_t num_l = 4*n;
+
+        // distinct indices in [0, 16 C(n, 2))
+        std::set<std::size_t> l2s;
+        for (LineId i = 0; i < LineId(num_l); i++)
+            for (LineId j = i + 1; j < LineId(num_l); j++)
+                if (i/4 != j/4) {
+                    REQUIRE(t.l2(i, j) < 16*SofaTables::comb2(n));
+                    l2s.insert(t.l2(i, j));
+                }
+        REQUIRE(l2s.size() == 16*SofaTables::comb2(n));
+
+        // each triple containing l appears in the list of l
+        std::set<std::size_t> l3s;
+        for (LineId i = 0; i < LineId(num_l); i++)
+            for (LineId j = i + 1; j < LineId(num_l); j++)
+                for (LineId k = j + 1; k < LineId(num_l); k++)
+                    if (i/4 != j/4 && j/4 != k/4 && i/4 != k/4)
+                        l3s.insert(t.l3(i, j, k));
+        REQUIRE(l3s.size() == 64*SofaTables::comb3(n));
+        REQUIRE(*l3s.rbegin() < 64*SofaTables::comb3(n));
+        for (LineId l = 0; l < LineId(num_l); l++) {
+            const std::uint32_t *with_l = t.l3_with_l(l);
+            std::set<std::size_t> got(with_l, with_l + t.num_l3_with_l());
+            REQUIRE(got.size() == t.num_l3_with_l());
+            for (std::size_t x : got)
+                REQUIRE(l3s.count(x));
+        }
+        // the same other two lines for the two lines of a band
+        for (std::size_t i = 0; i < t.num_l3_with_l(); i++)
+            REQUIRE(t.l3_with_l(4)[i] / 8 == t.l3_with_l(5)[i] / 8);
+    }
+}
+
+TEST_CASE( "SofaTables are written once and mapped", "[SofaTables]" ) {
+    std::string path = "/tmp/sofa_tables_test" + std::to_string(getpid());
+    std::remove(path.c_str());
+    // n not used elsewhere, so that get() has not built it yet
+    REQUIRE(SofaTables::load(path, 13));
+    const SofaTables &t = SofaTables::get(13);
+    REQUIRE(t.is_mapped());
+    REQUIRE(t.n() == 13);
+    REQUIRE(t.l3(0, 4, 8) == SofaTables::get(3).l3(0, 4, 8));
+
+    // the file holds n = 13, so it is rewritten for another n
+    REQUIRE(SofaTables::load(path, 14));
+    REQUIRE(SofaTables::get(14).is_mapped());
+    REQUIRE(SofaTables::get(14).num_l3_with_l() == 16*SofaTables::comb2(13));
+    std::remove(path.c_str());
+
+    REQUIRE(!SofaTables::load("/nonexistent/dir/tables", 15));
+    REQUIRE(!SofaTables::get(15).is_mapped());
+}
+
+}; // namespace sofa
+}; // namespace sofa_designer